@@ -1,16 +1,65 @@
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <vector>
+#include <array>
 #include <algorithm>
 #include <numeric>
 #include <fstream>
 #include <sstream>
 #include <iomanip>
 #include <memory>
+#include <memory_resource>
 #include <map>
+#include <list>
+#include <optional>
+#include <deque>
+#include <unordered_map>
 #include <stdexcept>
 #include <cmath>
 #include <functional>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <future>
+#include <exception>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <charconv>
+#include <cstdio>
+#include <limits>
+#include <utility>
+#include <concepts>
+#include <type_traits>
+#include <filesystem>
+#include <bit>
+#include <new>
+#if defined(__unix__) || defined(__APPLE__)
+#define SSP_HAVE_MMAP 1
+#define SSP_HAVE_FSYNC 1
+#define SSP_HAVE_SOCKETS 1
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <csignal>
+#endif
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 template <typename T>
 T clamp(const T& v, const T& lo, const T& hi) {
@@ -18,202 +67,4976 @@ T clamp(const T& v, const T& lo, const T& hi) {
     if (v > hi) return hi;
     return v;
 }
+// NaN passes every comparison above (and clamp), so inputs that reach a plan
+// are checked for being finite where they enter.
+inline void requireHours(double hrs) {
+    if (!std::isfinite(hrs) || hrs < 0.0) throw std::runtime_error("Hours must be finite and non-negative");
+}
+inline void requireScore(std::string_view name, double score) {
+    if (!std::isfinite(score)) throw std::runtime_error("Invalid score for " + std::string(name));
+}
+// Text rendering helpers. They append to a caller's buffer with std::to_chars,
+// so reusing one buffer makes rendering allocation-free. The output matches
+// the iostream formatting they replace (std::fixed/setprecision, std::left/setw).
+void appendFixed(std::string& out, double v, int prec) {
+    char buf[64];
+    auto r = std::to_chars(buf, buf + sizeof buf, v, std::chars_format::fixed, prec);
+    if (r.ec == std::errc()) {
+        out.append(buf, r.ptr);
+        return;
+    }
+    std::string big(320 + static_cast<std::size_t>(std::max(prec, 0)), '\0');  // DBL_MAX has 309 digits
+    r = std::to_chars(big.data(), big.data() + big.size(), v, std::chars_format::fixed, prec);
+    out.append(big.data(), r.ptr);
+}
+template <std::integral T>
+void appendInt(std::string& out, T v) {
+    char buf[24];
+    out.append(buf, std::to_chars(buf, buf + sizeof buf, v).ptr);
+}
+// Left-aligns the field that starts at out[start] in width columns.
+void padField(std::string& out, std::size_t start, std::size_t width) {
+    if (out.size() - start < width) out.append(width - (out.size() - start), ' ');
+}
+void appendPadded(std::string& out, std::string_view s, std::size_t width) {
+    std::size_t start = out.size();
+    out += s;
+    padField(out, start, width);
+}
 std::string fmtd(double v, int prec = 2) {
-    std::ostringstream oss;
-    oss << std::fixed << std::setprecision(prec) << v;
-    return oss.str();
+    std::string out;
+    appendFixed(out, v, prec);
+    return out;
+}
+struct NameHash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view s) const noexcept { return std::hash<std::string_view>{}(s); }
+};
+constexpr double priorityWeightOf(int difficulty, int importance, double perfScore) {
+    double perfFactor = 1.5 - (perfScore / 100.0);
+    double base = static_cast<double>(difficulty) * static_cast<double>(importance);
+    return base * perfFactor;
+}
+// A weighting policy is a type with a static weight(difficulty, importance,
+// perfScore); it may also provide a static weights(...) pass over whole columns
+// with the same signature as computeWeights. Policies are template arguments,
+// so the formula inlines into the weight loop.
+template <typename P>
+concept WeightingPolicy = requires(int d, int i, double perf) {
+    { P::weight(d, i, perf) } -> std::convertible_to<double>;
+};
+struct DefaultWeighting {
+    static constexpr double weight(int difficulty, int importance, double perfScore) {
+        return priorityWeightOf(difficulty, importance, perfScore);
+    }
+};
+static_assert(DefaultWeighting::weight(4, 5, 50.0) == 20.0, "default weighting must match priorityWeight");
+void scalarWeights(const int* difficulty, const int* importance, const double* perfScore,
+                   double* out, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) out[i] = priorityWeightOf(difficulty[i], importance[i], perfScore[i]);
+}
+double scalarShareClampSum(double* alloc, std::size_t n, double sumWeights, double totalHours,
+                           double minSlot, double sum = 0.0) {
+    for (std::size_t i = 0; i < n; ++i) {
+        alloc[i] = std::max((alloc[i] / sumWeights) * totalHours, minSlot);
+        sum += alloc[i];
+    }
+    return sum;
+}
+void scalarScaleRound(double* alloc, std::size_t n, double factor) {
+    for (std::size_t i = 0; i < n; ++i) alloc[i] = std::round(alloc[i] * factor * 100.0) / 100.0;
+}
+double scalarBoostClampSum(const double* perfScore, double* hours, std::size_t n, double totalHours,
+                           double lowThreshold, double highThreshold, double boostFactor, double reduceFactor,
+                           double sum = 0.0) {
+    for (std::size_t i = 0; i < n; ++i) {
+        double newHours = hours[i];
+        if (perfScore[i] < lowThreshold) newHours = hours[i] * boostFactor;
+        else if (perfScore[i] > highThreshold) newHours = hours[i] * reduceFactor;
+        hours[i] = std::max(0.0, clamp(newHours, 0.1, totalHours));
+        sum += hours[i];
+    }
+    return sum;
+}
+void scalarRescaleRound(double* hours, std::size_t n, double scale) {
+    for (std::size_t i = 0; i < n; ++i) hours[i] = std::max(0.0, std::round(hours[i] * scale * 100.0) / 100.0);
+}
+// The vector kernels mirror the scalar ones operation for operation, so their
+// output is bit-identical. Running sums are still added lane by lane in index
+// order. x86 has no round-half-away-from-zero instruction, so std::round is
+// rebuilt from trunc plus an exact test on the fractional part.
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SSP_SIMD_X86 1
+#define SSP_TARGET(isa) __attribute__((target(isa)))
+SSP_TARGET("avx2") inline __m256d roundAwayAvx2(__m256d x) {
+    const __m256d t = _mm256_round_pd(x, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    const __m256d absMask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffLL));
+    const __m256d frac = _mm256_and_pd(_mm256_sub_pd(x, t), absMask);
+    const __m256d away = _mm256_blendv_pd(_mm256_set1_pd(1.0), _mm256_set1_pd(-1.0),
+                                          _mm256_cmp_pd(x, _mm256_setzero_pd(), _CMP_LT_OQ));
+    return _mm256_blendv_pd(t, _mm256_add_pd(t, away), _mm256_cmp_pd(frac, _mm256_set1_pd(0.5), _CMP_GE_OQ));
+}
+SSP_TARGET("avx2") inline double addLanesAvx2(double sum, __m256d v) {
+    alignas(32) double lane[4];
+    _mm256_store_pd(lane, v);
+    for (double x : lane) sum += x;
+    return sum;
+}
+SSP_TARGET("avx2") void avx2Weights(const int* difficulty, const int* importance, const double* perfScore,
+                                    double* out, std::size_t n) {
+    const __m256d c15 = _mm256_set1_pd(1.5), c100 = _mm256_set1_pd(100.0);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d d = _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i*>(difficulty + i)));
+        __m256d m = _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i*>(importance + i)));
+        __m256d factor = _mm256_sub_pd(c15, _mm256_div_pd(_mm256_loadu_pd(perfScore + i), c100));
+        _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_mul_pd(d, m), factor));
+    }
+    scalarWeights(difficulty + i, importance + i, perfScore + i, out + i, n - i);
+}
+SSP_TARGET("avx2") double avx2ShareClampSum(double* alloc, std::size_t n, double sumWeights,
+                                            double totalHours, double minSlot) {
+    const __m256d sw = _mm256_set1_pd(sumWeights), th = _mm256_set1_pd(totalHours), ms = _mm256_set1_pd(minSlot);
+    double sum = 0.0;
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d v = _mm256_max_pd(ms, _mm256_mul_pd(_mm256_div_pd(_mm256_loadu_pd(alloc + i), sw), th));
+        _mm256_storeu_pd(alloc + i, v);
+        sum = addLanesAvx2(sum, v);
+    }
+    return scalarShareClampSum(alloc + i, n - i, sumWeights, totalHours, minSlot, sum);
+}
+SSP_TARGET("avx2") void avx2ScaleRound(double* alloc, std::size_t n, double factor) {
+    const __m256d f = _mm256_set1_pd(factor), c100 = _mm256_set1_pd(100.0);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d v = roundAwayAvx2(_mm256_mul_pd(_mm256_mul_pd(_mm256_loadu_pd(alloc + i), f), c100));
+        _mm256_storeu_pd(alloc + i, _mm256_div_pd(v, c100));
+    }
+    scalarScaleRound(alloc + i, n - i, factor);
+}
+SSP_TARGET("avx2") double avx2BoostClampSum(const double* perfScore, double* hours, std::size_t n,
+                                            double totalHours, double lowThreshold, double highThreshold,
+                                            double boostFactor, double reduceFactor) {
+    const __m256d lo = _mm256_set1_pd(lowThreshold), hi = _mm256_set1_pd(highThreshold);
+    const __m256d bf = _mm256_set1_pd(boostFactor), rf = _mm256_set1_pd(reduceFactor);
+    const __m256d minH = _mm256_set1_pd(0.1), maxH = _mm256_set1_pd(totalHours), zero = _mm256_setzero_pd();
+    double sum = 0.0;
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d p = _mm256_loadu_pd(perfScore + i), h = _mm256_loadu_pd(hours + i);
+        __m256d v = _mm256_blendv_pd(h, _mm256_mul_pd(h, rf), _mm256_cmp_pd(p, hi, _CMP_GT_OQ));
+        v = _mm256_blendv_pd(v, _mm256_mul_pd(h, bf), _mm256_cmp_pd(p, lo, _CMP_LT_OQ));
+        __m256d c = _mm256_blendv_pd(v, maxH, _mm256_cmp_pd(v, maxH, _CMP_GT_OQ));
+        c = _mm256_blendv_pd(c, minH, _mm256_cmp_pd(v, minH, _CMP_LT_OQ));
+        c = _mm256_blendv_pd(zero, c, _mm256_cmp_pd(zero, c, _CMP_LT_OQ));
+        _mm256_storeu_pd(hours + i, c);
+        sum = addLanesAvx2(sum, c);
+    }
+    return scalarBoostClampSum(perfScore + i, hours + i, n - i, totalHours, lowThreshold, highThreshold,
+                               boostFactor, reduceFactor, sum);
+}
+SSP_TARGET("avx2") void avx2RescaleRound(double* hours, std::size_t n, double scale) {
+    const __m256d s = _mm256_set1_pd(scale), c100 = _mm256_set1_pd(100.0), zero = _mm256_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d v = roundAwayAvx2(_mm256_mul_pd(_mm256_mul_pd(_mm256_loadu_pd(hours + i), s), c100));
+        v = _mm256_div_pd(v, c100);
+        _mm256_storeu_pd(hours + i, _mm256_blendv_pd(zero, v, _mm256_cmp_pd(zero, v, _CMP_LT_OQ)));
+    }
+    scalarRescaleRound(hours + i, n - i, scale);
+}
+// The AVX-512 kernels run the tail as one more block under a lane mask: masked
+// loads zero the missing lanes, which are neither stored nor summed. Every
+// operation is a masked (maskz_) form, since GCC 12's unmasked ones merge into
+// _mm512_undefined_pd() and warn under -Wmaybe-uninitialized.
+SSP_TARGET("avx512f") inline __mmask8 laneMaskAvx512(std::size_t remaining) {
+    return remaining >= 8 ? static_cast<__mmask8>(0xFF) : static_cast<__mmask8>((1u << remaining) - 1);
+}
+SSP_TARGET("avx512f") inline __m512d roundAwayAvx512(__mmask8 k, __m512d x) {
+    const __m512d t = _mm512_maskz_roundscale_pd(k, x, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    const __mmask8 neg = _mm512_cmp_pd_mask(x, _mm512_setzero_pd(), _CMP_LT_OQ);
+    const __m512d away = _mm512_mask_blend_pd(neg, _mm512_set1_pd(1.0), _mm512_set1_pd(-1.0));
+    const __mmask8 up = _mm512_cmp_pd_mask(_mm512_abs_pd(_mm512_sub_pd(x, t)), _mm512_set1_pd(0.5), _CMP_GE_OQ);
+    return _mm512_mask_add_pd(t, up, t, away);
+}
+SSP_TARGET("avx512f") inline double addLanesAvx512(double sum, __m512d v, std::size_t lanes) {
+    alignas(64) double lane[8];
+    _mm512_store_pd(lane, v);
+    for (std::size_t j = 0; j < lanes; ++j) sum += lane[j];
+    return sum;
+}
+// k lanes of int32 widened to double (the low half of a zero-masked 512-bit load).
+SSP_TARGET("avx512f") inline __m512d loadIntsAvx512(__mmask8 k, const int* p) {
+    const __m256i ints = _mm512_maskz_extracti64x4_epi64(0xF, _mm512_maskz_loadu_epi32(k, p), 0);
+    return _mm512_maskz_cvtepi32_pd(k, ints);
+}
+SSP_TARGET("avx512f") void avx512Weights(const int* difficulty, const int* importance, const double* perfScore,
+                                         double* out, std::size_t n) {
+    const __m512d c15 = _mm512_set1_pd(1.5), c100 = _mm512_set1_pd(100.0);
+    for (std::size_t i = 0; i < n; i += 8) {
+        const __mmask8 k = laneMaskAvx512(n - i);
+        __m512d d = loadIntsAvx512(k, difficulty + i);
+        __m512d m = loadIntsAvx512(k, importance + i);
+        __m512d factor = _mm512_sub_pd(c15, _mm512_div_pd(_mm512_maskz_loadu_pd(k, perfScore + i), c100));
+        _mm512_mask_storeu_pd(out + i, k, _mm512_mul_pd(_mm512_mul_pd(d, m), factor));
+    }
+}
+SSP_TARGET("avx512f") double avx512ShareClampSum(double* alloc, std::size_t n, double sumWeights,
+                                                 double totalHours, double minSlot) {
+    const __m512d sw = _mm512_set1_pd(sumWeights), th = _mm512_set1_pd(totalHours), ms = _mm512_set1_pd(minSlot);
+    double sum = 0.0;
+    for (std::size_t i = 0; i < n; i += 8) {
+        const __mmask8 k = laneMaskAvx512(n - i);
+        __m512d v = _mm512_maskz_max_pd(k, ms, _mm512_mul_pd(_mm512_div_pd(_mm512_maskz_loadu_pd(k, alloc + i), sw), th));
+        _mm512_mask_storeu_pd(alloc + i, k, v);
+        sum = addLanesAvx512(sum, v, std::min<std::size_t>(n - i, 8));
+    }
+    return sum;
+}
+SSP_TARGET("avx512f") void avx512ScaleRound(double* alloc, std::size_t n, double factor) {
+    const __m512d f = _mm512_set1_pd(factor), c100 = _mm512_set1_pd(100.0);
+    for (std::size_t i = 0; i < n; i += 8) {
+        const __mmask8 k = laneMaskAvx512(n - i);
+        __m512d v = roundAwayAvx512(k, _mm512_mul_pd(_mm512_mul_pd(_mm512_maskz_loadu_pd(k, alloc + i), f), c100));
+        _mm512_mask_storeu_pd(alloc + i, k, _mm512_div_pd(v, c100));
+    }
+}
+SSP_TARGET("avx512f") double avx512BoostClampSum(const double* perfScore, double* hours, std::size_t n,
+                                                 double totalHours, double lowThreshold, double highThreshold,
+                                                 double boostFactor, double reduceFactor) {
+    const __m512d lo = _mm512_set1_pd(lowThreshold), hi = _mm512_set1_pd(highThreshold);
+    const __m512d bf = _mm512_set1_pd(boostFactor), rf = _mm512_set1_pd(reduceFactor);
+    const __m512d minH = _mm512_set1_pd(0.1), maxH = _mm512_set1_pd(totalHours), zero = _mm512_setzero_pd();
+    double sum = 0.0;
+    for (std::size_t i = 0; i < n; i += 8) {
+        const __mmask8 k = laneMaskAvx512(n - i);
+        __m512d p = _mm512_maskz_loadu_pd(k, perfScore + i), h = _mm512_maskz_loadu_pd(k, hours + i);
+        __m512d v = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(p, hi, _CMP_GT_OQ), h, _mm512_mul_pd(h, rf));
+        v = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(p, lo, _CMP_LT_OQ), v, _mm512_mul_pd(h, bf));
+        __m512d c = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(v, maxH, _CMP_GT_OQ), v, maxH);
+        c = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(v, minH, _CMP_LT_OQ), c, minH);
+        c = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(zero, c, _CMP_LT_OQ), zero, c);
+        _mm512_mask_storeu_pd(hours + i, k, c);
+        sum = addLanesAvx512(sum, c, std::min<std::size_t>(n - i, 8));
+    }
+    return sum;
+}
+SSP_TARGET("avx512f") void avx512RescaleRound(double* hours, std::size_t n, double scale) {
+    const __m512d s = _mm512_set1_pd(scale), c100 = _mm512_set1_pd(100.0), zero = _mm512_setzero_pd();
+    for (std::size_t i = 0; i < n; i += 8) {
+        const __mmask8 k = laneMaskAvx512(n - i);
+        __m512d v = roundAwayAvx512(k, _mm512_mul_pd(_mm512_mul_pd(_mm512_maskz_loadu_pd(k, hours + i), s), c100));
+        v = _mm512_div_pd(v, c100);
+        _mm512_mask_storeu_pd(hours + i, k, _mm512_mask_blend_pd(_mm512_cmp_pd_mask(zero, v, _CMP_LT_OQ), zero, v));
+    }
+}
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define SSP_SIMD_NEON 1
+inline double addLanesNeon(double sum, float64x2_t v) {
+    sum += vgetq_lane_f64(v, 0);
+    sum += vgetq_lane_f64(v, 1);
+    return sum;
+}
+void neonWeights(const int* difficulty, const int* importance, const double* perfScore,
+                 double* out, std::size_t n) {
+    const float64x2_t c15 = vdupq_n_f64(1.5), c100 = vdupq_n_f64(100.0);
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        float64x2_t d = vcvtq_f64_s64(vmovl_s32(vld1_s32(difficulty + i)));
+        float64x2_t m = vcvtq_f64_s64(vmovl_s32(vld1_s32(importance + i)));
+        float64x2_t factor = vsubq_f64(c15, vdivq_f64(vld1q_f64(perfScore + i), c100));
+        vst1q_f64(out + i, vmulq_f64(vmulq_f64(d, m), factor));
+    }
+    scalarWeights(difficulty + i, importance + i, perfScore + i, out + i, n - i);
+}
+double neonShareClampSum(double* alloc, std::size_t n, double sumWeights, double totalHours, double minSlot) {
+    const float64x2_t sw = vdupq_n_f64(sumWeights), th = vdupq_n_f64(totalHours), ms = vdupq_n_f64(minSlot);
+    double sum = 0.0;
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        float64x2_t v = vmulq_f64(vdivq_f64(vld1q_f64(alloc + i), sw), th);
+        v = vbslq_f64(vcltq_f64(v, ms), ms, v);
+        vst1q_f64(alloc + i, v);
+        sum = addLanesNeon(sum, v);
+    }
+    return scalarShareClampSum(alloc + i, n - i, sumWeights, totalHours, minSlot, sum);
+}
+void neonScaleRound(double* alloc, std::size_t n, double factor) {
+    const float64x2_t f = vdupq_n_f64(factor), c100 = vdupq_n_f64(100.0);
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        float64x2_t v = vrndaq_f64(vmulq_f64(vmulq_f64(vld1q_f64(alloc + i), f), c100));
+        vst1q_f64(alloc + i, vdivq_f64(v, c100));
+    }
+    scalarScaleRound(alloc + i, n - i, factor);
+}
+double neonBoostClampSum(const double* perfScore, double* hours, std::size_t n, double totalHours,
+                         double lowThreshold, double highThreshold, double boostFactor, double reduceFactor) {
+    const float64x2_t lo = vdupq_n_f64(lowThreshold), hi = vdupq_n_f64(highThreshold);
+    const float64x2_t bf = vdupq_n_f64(boostFactor), rf = vdupq_n_f64(reduceFactor);
+    const float64x2_t minH = vdupq_n_f64(0.1), maxH = vdupq_n_f64(totalHours), zero = vdupq_n_f64(0.0);
+    double sum = 0.0;
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        float64x2_t p = vld1q_f64(perfScore + i), h = vld1q_f64(hours + i);
+        float64x2_t v = vbslq_f64(vcgtq_f64(p, hi), vmulq_f64(h, rf), h);
+        v = vbslq_f64(vcltq_f64(p, lo), vmulq_f64(h, bf), v);
+        float64x2_t c = vbslq_f64(vcgtq_f64(v, maxH), maxH, v);
+        c = vbslq_f64(vcltq_f64(v, minH), minH, c);
+        c = vbslq_f64(vcltq_f64(zero, c), c, zero);
+        vst1q_f64(hours + i, c);
+        sum = addLanesNeon(sum, c);
+    }
+    return scalarBoostClampSum(perfScore + i, hours + i, n - i, totalHours, lowThreshold, highThreshold,
+                               boostFactor, reduceFactor, sum);
+}
+void neonRescaleRound(double* hours, std::size_t n, double scale) {
+    const float64x2_t s = vdupq_n_f64(scale), c100 = vdupq_n_f64(100.0), zero = vdupq_n_f64(0.0);
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        float64x2_t v = vdivq_f64(vrndaq_f64(vmulq_f64(vmulq_f64(vld1q_f64(hours + i), s), c100)), c100);
+        vst1q_f64(hours + i, vbslq_f64(vcltq_f64(zero, v), v, zero));
+    }
+    scalarRescaleRound(hours + i, n - i, scale);
+}
+#endif
+struct AllocationKernels {
+    const char* isa;
+    void (*weights)(const int*, const int*, const double*, double*, std::size_t);
+    double (*shareClampSum)(double*, std::size_t, double, double, double);
+    void (*scaleRound)(double*, std::size_t, double);
+    double (*boostClampSum)(const double*, double*, std::size_t, double, double, double, double, double);
+    void (*rescaleRound)(double*, std::size_t, double);
+};
+// Picks the widest instruction set the CPU supports; SSP_SIMD=scalar|avx2|avx512|neon
+// forces a narrower one (e.g. to compare against the scalar path).
+AllocationKernels selectAllocationKernels() {
+    const char* env = std::getenv("SSP_SIMD");
+    std::string want = env ? env : "";
+    AllocationKernels k{"scalar", scalarWeights,
+                        [](double* a, std::size_t n, double sw, double th, double ms) {
+                            return scalarShareClampSum(a, n, sw, th, ms);
+                        },
+                        scalarScaleRound,
+                        [](const double* p, double* h, std::size_t n, double th, double lo, double hi,
+                           double bf, double rf) { return scalarBoostClampSum(p, h, n, th, lo, hi, bf, rf); },
+                        scalarRescaleRound};
+    if (want == "scalar") return k;
+#if defined(SSP_SIMD_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && (want.empty() || want == "avx512"))
+        return {"avx512", avx512Weights, avx512ShareClampSum, avx512ScaleRound, avx512BoostClampSum, avx512RescaleRound};
+    if (__builtin_cpu_supports("avx2"))
+        return {"avx2", avx2Weights, avx2ShareClampSum, avx2ScaleRound, avx2BoostClampSum, avx2RescaleRound};
+#elif defined(SSP_SIMD_NEON)
+    return {"neon", neonWeights, neonShareClampSum, neonScaleRound, neonBoostClampSum, neonRescaleRound};
+#endif
+    return k;
+}
+const AllocationKernels& allocationKernels() {
+    static const AllocationKernels kernels = selectAllocationKernels();
+    return kernels;
+}
+void computeWeights(const int* difficulty, const int* importance, const double* perfScore,
+                    double* out, std::size_t n) {
+    allocationKernels().weights(difficulty, importance, perfScore, out, n);
+}
+// Same as computeWeights under another policy. The default policy keeps the
+// dispatched SIMD kernel; others use their own column pass or a plain loop the
+// compiler can vectorize.
+template <WeightingPolicy Policy>
+void computeWeightsWith(const int* difficulty, const int* importance, const double* perfScore,
+                        double* out, std::size_t n) {
+    if constexpr (std::is_same_v<Policy, DefaultWeighting>) {
+        computeWeights(difficulty, importance, perfScore, out, n);
+    } else if constexpr (requires { Policy::weights(difficulty, importance, perfScore, out, n); }) {
+        Policy::weights(difficulty, importance, perfScore, out, n);
+    } else {
+        for (std::size_t i = 0; i < n; ++i) out[i] = Policy::weight(difficulty[i], importance[i], perfScore[i]);
+    }
+}
+// Turns priority weights into rounded daily hours in place (the generateSchedule allocation).
+void proportionalAllocate(double* alloc, std::size_t n, double totalHours) {
+    if (n == 0) return;
+    double sumWeights = std::accumulate(alloc, alloc + n, 0.0);
+    if (sumWeights <= 0.0) {
+        std::fill(alloc, alloc + n, totalHours / static_cast<double>(n));
+        return;
+    }
+    const auto& k = allocationKernels();
+    double rawSum = k.shareClampSum(alloc, n, sumWeights, totalHours, 0.25);
+    k.scaleRound(alloc, n, rawSum > 0.0 ? totalHours / rawSum : 1.0);
 }
+// Days until the exam count the exam day itself; subjects without a date are
+// treated as due kUndatedDays out, and exams already past get no urgency.
+constexpr int kNoDueDay = -1;
+constexpr int kUndatedDays = 28;
+double deadlineUrgency(double weight, int dueDay, int today) {
+    if (dueDay == kNoDueDay) return weight / (kUndatedDays + 1);
+    if (dueDay < today) return 0.0;
+    return weight / (dueDay - today + 1);
+}
+// Deadline mode: urgencies in, rounded daily hours out. Hours go out one
+// minSlot at a time to the subject with the largest urgency / (slots + 1)
+// (D'Hondt), so a day costs O(n + slots * log n).
+void deadlineAllocate(double* alloc, std::size_t n, double totalHours, double minSlot = 0.25) {
+    std::vector<std::pair<double, std::size_t>> heap;
+    heap.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        if (alloc[i] > 0.0) heap.emplace_back(alloc[i], i);
+        alloc[i] = 0.0;
+    }
+    if (heap.empty() || !(totalHours > 0.0)) return;
+    std::vector<double> urgency(n, 0.0);
+    for (const auto& [u, i] : heap) urgency[i] = u;
+    auto less = [](const auto& a, const auto& b) { return a.first < b.first || (a.first == b.first && a.second > b.second); };
+    std::make_heap(heap.begin(), heap.end(), less);
+    double left = totalHours;
+    while (left > 1e-9) {
+        std::pop_heap(heap.begin(), heap.end(), less);
+        auto& [quotient, i] = heap.back();
+        double slot = std::min(minSlot, left);
+        alloc[i] += slot;
+        left -= slot;
+        quotient = urgency[i] / (alloc[i] / minSlot + 1.0);
+        std::push_heap(heap.begin(), heap.end(), less);
+    }
+    for (std::size_t i = 0; i < n; ++i) alloc[i] = std::round(alloc[i] * 100.0) / 100.0;
+}
+// Boost/reduce/clamp pass followed by the rescale to totalHours (the adaptiveAdjust allocation).
+void adaptiveRescale(const double* perfScore, double* hours, std::size_t n, double totalHours,
+                     double lowThreshold, double highThreshold, double boostFactor, double reduceFactor) {
+    const auto& k = allocationKernels();
+    double sum = k.boostClampSum(perfScore, hours, n, totalHours, lowThreshold, highThreshold,
+                                 boostFactor, reduceFactor);
+    if (sum <= 0) return;
+    k.rescaleRound(hours, n, totalHours / sum);
+}
+// Hot-path instrumentation, compiled in with -DSSP_METRICS. Each thread
+// records into its own counters and log-linear latency histograms (16
+// sub-buckets per power of two, so quantiles are within ~6%), which
+// prometheusMetrics() merges on demand. Scopes also attribute the global
+// operator new calls made on their thread. Without the flag the
+// SSP_METRIC_* macros expand to nothing and none of this is compiled.
+#ifdef SSP_METRICS
+enum class Metric : std::uint8_t { Replan, GenerateSchedule, AdaptiveAdjust, RecordPerformance, LoadFile, SaveFile, Count };
+constexpr std::size_t kMetricCount = static_cast<std::size_t>(Metric::Count);
+constexpr const char* metricName(Metric m) {
+    constexpr const char* names[] = {"replan", "generate_schedule", "adaptive_adjust",
+                                     "record_performance", "load_file", "save_file"};
+    return names[static_cast<std::size_t>(m)];
+}
+// Constant-initialized so operator new can bump it without a TLS guard.
+struct AllocationTally { std::uint64_t count = 0, bytes = 0; };
+constinit thread_local AllocationTally tlAllocations;
+class LatencyHistogram {
+public:
+    static constexpr unsigned kSubBits = 4;
+    static constexpr std::size_t kSub = std::size_t{1} << kSubBits;
+    static constexpr std::size_t kBuckets = (64 - kSubBits + 1) * kSub;
+    static std::size_t bucketOf(std::uint64_t ns) {
+        if (ns < kSub) return static_cast<std::size_t>(ns);
+        unsigned msb = 63 - static_cast<unsigned>(std::countl_zero(ns));
+        return (msb - kSubBits + 1) * kSub + static_cast<std::size_t>((ns >> (msb - kSubBits)) & (kSub - 1));
+    }
+    // Largest value that lands in the bucket.
+    static std::uint64_t upperBound(std::size_t b) {
+        if (b < kSub) return b;
+        unsigned shift = static_cast<unsigned>(b / kSub - 1);
+        return ((kSub + b % kSub + 1) << shift) - 1;
+    }
+};
+// One thread's numbers for one operation. Only the owning thread writes, so
+// relaxed load/store pairs are enough and readers never see torn values.
+struct OperationCounters {
+    std::atomic<std::uint64_t> calls{0}, totalNs{0}, maxNs{0}, subjects{0}, allocations{0}, allocatedBytes{0};
+    std::array<std::atomic<std::uint64_t>, LatencyHistogram::kBuckets> buckets{};
+};
+struct MetricSample {
+    std::uint64_t calls = 0, totalNs = 0, maxNs = 0, subjects = 0, allocations = 0, allocatedBytes = 0;
+    std::array<std::uint64_t, LatencyHistogram::kBuckets> buckets{};
+    void add(const OperationCounters& c) {
+        calls += c.calls.load(std::memory_order_relaxed);
+        totalNs += c.totalNs.load(std::memory_order_relaxed);
+        maxNs = std::max(maxNs, c.maxNs.load(std::memory_order_relaxed));
+        subjects += c.subjects.load(std::memory_order_relaxed);
+        allocations += c.allocations.load(std::memory_order_relaxed);
+        allocatedBytes += c.allocatedBytes.load(std::memory_order_relaxed);
+        for (std::size_t b = 0; b < buckets.size(); ++b) buckets[b] += c.buckets[b].load(std::memory_order_relaxed);
+    }
+    // Upper edge of the bucket holding quantile q (0-1), in nanoseconds.
+    std::uint64_t quantileNs(double q) const {
+        if (calls == 0) return 0;
+        auto rank = static_cast<std::uint64_t>(std::ceil(q * static_cast<double>(calls)));
+        std::uint64_t seen = 0;
+        for (std::size_t b = 0; b < buckets.size(); ++b)
+            if ((seen += buckets[b]) >= std::max<std::uint64_t>(rank, 1))
+                return std::min(LatencyHistogram::upperBound(b), maxNs);
+        return maxNs;
+    }
+};
+class MetricsRegistry {
+public:
+    using Thread = std::array<OperationCounters, kMetricCount>;
+    static MetricsRegistry& instance() {
+        static MetricsRegistry* registry = new MetricsRegistry;  // outlives thread_local handles
+        return *registry;
+    }
+    static Thread& local() {
+        thread_local Handle handle;
+        return *handle.counters;
+    }
+    std::array<MetricSample, kMetricCount> sample() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::array<MetricSample, kMetricCount> out = retired_;
+        for (const auto& t : live_)
+            for (std::size_t m = 0; m < kMetricCount; ++m) out[m].add((*t)[m]);
+        return out;
+    }
+private:
+    struct Handle {
+        Thread* counters;
+        Handle() {
+            auto owned = std::make_unique<Thread>();
+            counters = owned.get();
+            auto& r = instance();
+            std::lock_guard<std::mutex> lock(r.mutex_);
+            r.live_.push_back(std::move(owned));
+        }
+        // Folds the exiting thread's numbers into the retired totals.
+        ~Handle() {
+            auto& r = instance();
+            std::lock_guard<std::mutex> lock(r.mutex_);
+            for (std::size_t m = 0; m < kMetricCount; ++m) r.retired_[m].add((*counters)[m]);
+            std::erase_if(r.live_, [&](const auto& t) { return t.get() == counters; });
+        }
+    };
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<Thread>> live_;
+    std::array<MetricSample, kMetricCount> retired_{};
+};
+// Times one operation on the calling thread and charges its allocations and
+// the subjects it touched to the operation's counters.
+class MetricScope {
+public:
+    MetricScope(Metric m, std::size_t subjects)
+        : metric_(m), subjects_(subjects), allocations_(tlAllocations),
+          start_(std::chrono::steady_clock::now()) {}
+    MetricScope(const MetricScope&) = delete;
+    MetricScope& operator=(const MetricScope&) = delete;
+    void touch(std::size_t subjects) { subjects_ += subjects; }
+    ~MetricScope() {
+        auto ns = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_).count());
+        OperationCounters& c = MetricsRegistry::local()[static_cast<std::size_t>(metric_)];
+        auto bump = [](std::atomic<std::uint64_t>& a, std::uint64_t v) {
+            a.store(a.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+        };
+        bump(c.calls, 1);
+        bump(c.totalNs, ns);
+        if (ns > c.maxNs.load(std::memory_order_relaxed)) c.maxNs.store(ns, std::memory_order_relaxed);
+        bump(c.subjects, subjects_);
+        bump(c.allocations, tlAllocations.count - allocations_.count);
+        bump(c.allocatedBytes, tlAllocations.bytes - allocations_.bytes);
+        bump(c.buckets[LatencyHistogram::bucketOf(ns)], 1);
+    }
+private:
+    Metric metric_;
+    std::size_t subjects_;
+    AllocationTally allocations_;
+    std::chrono::steady_clock::time_point start_;
+};
+// Prometheus text exposition of everything recorded so far: a latency summary
+// (p50/p90/p99/p999 from the histograms) plus counters for subjects touched
+// and allocations, labelled by operation.
+inline std::string prometheusMetrics() {
+    const auto samples = MetricsRegistry::instance().sample();
+    std::string out;
+    auto num = [&](double v) {
+        char buf[32];
+        out.append(buf, std::to_chars(buf, buf + sizeof buf, v).ptr);
+    };
+    auto line = [&](const char* metric, std::size_t m, const char* extra, double v) {
+        out += metric;
+        out += "{op=\"";
+        out += metricName(static_cast<Metric>(m));
+        out += '"';
+        out += extra;
+        out += "} ";
+        num(v);
+        out += '\n';
+    };
+    out += "# HELP ssp_operation_duration_seconds Latency of planner operations.\n"
+           "# TYPE ssp_operation_duration_seconds summary\n";
+    constexpr std::pair<double, const char*> quantiles[] = {
+        {0.5, ",quantile=\"0.5\""}, {0.9, ",quantile=\"0.9\""}, {0.99, ",quantile=\"0.99\""}, {0.999, ",quantile=\"0.999\""}};
+    for (std::size_t m = 0; m < kMetricCount; ++m) {
+        const MetricSample& s = samples[m];
+        for (const auto& [q, label] : quantiles)
+            line("ssp_operation_duration_seconds", m, label, static_cast<double>(s.quantileNs(q)) / 1e9);
+        line("ssp_operation_duration_seconds_sum", m, "", static_cast<double>(s.totalNs) / 1e9);
+        line("ssp_operation_duration_seconds_count", m, "", static_cast<double>(s.calls));
+    }
+    out += "# HELP ssp_operation_duration_seconds_max Slowest single call.\n"
+           "# TYPE ssp_operation_duration_seconds_max gauge\n";
+    for (std::size_t m = 0; m < kMetricCount; ++m)
+        line("ssp_operation_duration_seconds_max", m, "", static_cast<double>(samples[m].maxNs) / 1e9);
+    struct Counter { const char* name; const char* help; std::uint64_t MetricSample::*field; };
+    constexpr Counter counters[] = {
+        {"ssp_subjects_touched_total", "Subjects read or written by planner operations.", &MetricSample::subjects},
+        {"ssp_allocations_total", "Heap allocations made during planner operations.", &MetricSample::allocations},
+        {"ssp_allocated_bytes_total", "Bytes requested by those allocations.", &MetricSample::allocatedBytes}};
+    for (const Counter& c : counters) {
+        out += "# HELP ";
+        out += c.name;
+        out += ' ';
+        out += c.help;
+        out += "\n# TYPE ";
+        out += c.name;
+        out += " counter\n";
+        for (std::size_t m = 0; m < kMetricCount; ++m) line(c.name, m, "", static_cast<double>(samples[m].*c.field));
+    }
+    return out;
+}
+// Counts global operator new on the calling thread for MetricScope.
+void* operator new(std::size_t n) {
+    ++tlAllocations.count;
+    tlAllocations.bytes += n;
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+// GCC pairs the inlined free() with operator new and warns; the pairing is ours.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#define SSP_METRIC_SCOPE(metric, subjects) MetricScope sspMetricScope_(Metric::metric, subjects)
+#define SSP_METRIC_TOUCH(subjects) sspMetricScope_.touch(subjects)
+#else
+#define SSP_METRIC_SCOPE(metric, subjects) ((void)0)
+#define SSP_METRIC_TOUCH(subjects) ((void)0)
+#endif
+#ifndef SSP_SCORE_WINDOW
+#define SSP_SCORE_WINDOW 10
+#endif
+// Fixed-capacity ring of the most recent scores with a running sum, so adding
+// a score is O(1) and allocation-free. Once per full cycle the sum is
+// recomputed oldest-first, which keeps rounding drift bounded.
+template <std::size_t N>
+class ScoreWindow {
+    static_assert(N > 0, "score window needs room for at least one score");
+private:
+    std::array<double, N> values_{};
+    std::size_t head_ = 0;
+    std::size_t count_ = 0;
+    double sum_ = 0.0;
+public:
+    static constexpr std::size_t capacity() { return N; }
+    std::size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    double sum() const { return sum_; }
+    double mean() const { return sum_ / static_cast<double>(count_); }
+    // i = 0 is the oldest retained score.
+    double operator[](std::size_t i) const { return values_[(head_ + i) % N]; }
+    void push(double v) {
+        if (count_ < N) {
+            values_[(head_ + count_) % N] = v;
+            ++count_;
+            sum_ += v;
+            return;
+        }
+        sum_ += v - values_[head_];
+        values_[head_] = v;
+        head_ = (head_ + 1) % N;
+        if (head_ == 0) {
+            sum_ = 0.0;
+            for (double x : values_) sum_ += x;
+        }
+    }
+    void clear() { head_ = count_ = 0; sum_ = 0.0; }
+    void copyTo(double* out) const {
+        for (std::size_t i = 0; i < count_; ++i) out[i] = (*this)[i];
+    }
+    friend bool operator==(const ScoreWindow& a, const ScoreWindow& b) {
+        if (a.count_ != b.count_) return false;
+        for (std::size_t i = 0; i < a.count_; ++i) if (a[i] != b[i]) return false;
+        return true;
+    }
+};
+constexpr std::size_t kScoreWindow = SSP_SCORE_WINDOW;
+using ScoreHistory = ScoreWindow<kScoreWindow>;
+using NameId = std::uint32_t;
+// Process-wide table of subject names: each distinct name is stored once and
+// gets a dense id that never changes (0 is the empty name). Names live until
+// exit, so references handed out stay valid. Lookups take no lock: the id
+// table is open addressing over (hash tag, id) words that are only ever set,
+// and a grown table replaces the old one, which is kept for readers still on it.
+class NameInterner {
+private:
+    // Segment k holds kFirstSegment << k names, so names are never moved.
+    static constexpr std::size_t kFirstSegment = 1024;
+    static constexpr std::size_t kSegments = 23;
+    struct Table {
+        std::size_t mask;
+        std::unique_ptr<std::atomic<std::uint64_t>[]> slots;
+        explicit Table(std::size_t capacity) : mask(capacity - 1), slots(new std::atomic<std::uint64_t>[capacity]) {
+            for (std::size_t i = 0; i < capacity; ++i) slots[i].store(0, std::memory_order_relaxed);
+        }
+    };
+    std::array<std::atomic<std::string*>, kSegments> segments_{};
+    std::atomic<NameId> size_{0};
+    std::atomic<Table*> table_{nullptr};
+    std::vector<std::unique_ptr<Table>> tables_;  // current one last
+    mutable std::mutex mutex_;
+    static std::pair<std::size_t, std::size_t> locate(NameId id) {
+        const std::size_t k = std::bit_width(id / kFirstSegment + 1) - 1;
+        return {k, id - kFirstSegment * ((std::size_t(1) << k) - 1)};
+    }
+    // A slot is the top half of the hash over id + 1; zero marks an empty slot.
+    static std::uint64_t slotOf(std::uint64_t hash, NameId id) { return (hash & ~0xffffffffull) | (std::uint64_t(id) + 1); }
+    std::optional<NameId> lookup(const Table& t, std::string_view name, std::uint64_t hash) const {
+        for (std::size_t i = (hash >> 32) & t.mask;; i = (i + 1) & t.mask) {
+            const std::uint64_t v = t.slots[i].load(std::memory_order_acquire);
+            if (v == 0) return std::nullopt;
+            if ((v ^ hash) >> 32 == 0) {
+                const NameId id = static_cast<NameId>((v & 0xffffffffu) - 1);
+                if (this->name(id) == name) return id;
+            }
+        }
+    }
+    static void place(Table& t, std::uint64_t slot) {
+        std::size_t i = (slot >> 32) & t.mask;
+        while (t.slots[i].load(std::memory_order_relaxed) != 0) i = (i + 1) & t.mask;
+        t.slots[i].store(slot, std::memory_order_release);
+    }
+    static std::uint64_t hashOf(std::string_view name) {
+        return static_cast<std::uint64_t>(NameHash{}(name)) * 0x9e3779b97f4a7c15ull;
+    }
+    NameInterner() {
+        tables_.push_back(std::make_unique<Table>(1024));
+        table_.store(tables_.back().get(), std::memory_order_release);
+        intern("");
+    }
+public:
+    NameInterner(const NameInterner&) = delete;
+    NameInterner& operator=(const NameInterner&) = delete;
+    static NameInterner& global() {
+        static NameInterner* interner = new NameInterner;  // outlives every Subject
+        return *interner;
+    }
+    NameId intern(std::string_view name) {
+        const std::uint64_t hash = hashOf(name);
+        if (auto id = lookup(*table_.load(std::memory_order_acquire), name, hash)) return *id;
+        std::lock_guard lock(mutex_);
+        Table* t = table_.load(std::memory_order_relaxed);
+        if (auto id = lookup(*t, name, hash)) return *id;
+        const NameId id = size_.load(std::memory_order_relaxed);
+        if (id == std::numeric_limits<NameId>::max() - 1) throw std::runtime_error("Too many distinct subject names");
+        auto [seg, off] = locate(id);
+        std::string* block = segments_[seg].load(std::memory_order_relaxed);
+        if (!block) {
+            block = new std::string[kFirstSegment << seg];
+            segments_[seg].store(block, std::memory_order_release);
+        }
+        block[off].assign(name);
+        size_.store(id + 1, std::memory_order_release);
+        if (2 * (std::size_t(id) + 1) > t->mask + 1) {
+            auto grown = std::make_unique<Table>(2 * (t->mask + 1));
+            for (std::size_t i = 0; i <= t->mask; ++i)
+                if (std::uint64_t v = t->slots[i].load(std::memory_order_relaxed)) place(*grown, v);
+            t = grown.get();
+            tables_.push_back(std::move(grown));
+        }
+        place(*t, slotOf(hash, id));
+        table_.store(t, std::memory_order_release);
+        return id;
+    }
+    std::optional<NameId> find(std::string_view name) const {
+        const std::uint64_t hash = hashOf(name);
+        if (auto id = lookup(*table_.load(std::memory_order_acquire), name, hash)) return id;
+        // A reader on a table that has since been replaced may miss a new name.
+        std::lock_guard lock(mutex_);
+        return lookup(*table_.load(std::memory_order_relaxed), name, hash);
+    }
+    // The id must come from intern() (or find()) on this interner.
+    const std::string& name(NameId id) const {
+        auto [seg, off] = locate(id);
+        return segments_[seg].load(std::memory_order_acquire)[off];
+    }
+    std::size_t size() const { return size_.load(std::memory_order_acquire); }
+};
+// A subject name held as its interned id plus a pointer to the shared string.
+// Equality is an id compare; ordering is by the text, as with std::string.
+class InternedName {
+private:
+    const std::string* str_;
+    NameId id_;
+public:
+    InternedName() : InternedName(NameId(0)) {}
+    explicit InternedName(NameId id) : str_(&NameInterner::global().name(id)), id_(id) {}
+    InternedName(std::string_view name) : InternedName(NameInterner::global().intern(name)) {}
+    InternedName(const std::string& name) : InternedName(std::string_view(name)) {}
+    InternedName(const char* name) : InternedName(std::string_view(name)) {}
+    NameId id() const { return id_; }
+    const std::string& str() const { return *str_; }
+    std::string_view view() const { return *str_; }
+    operator const std::string&() const { return *str_; }
+    operator std::string_view() const { return *str_; }
+    friend bool operator==(const InternedName& a, const InternedName& b) { return a.id_ == b.id_; }
+    friend std::strong_ordering operator<=>(const InternedName& a, const InternedName& b) {
+        return a.id_ == b.id_ ? std::strong_ordering::equal : a.str_->compare(*b.str_) <=> 0;
+    }
+};
+inline std::ostream& operator<<(std::ostream& os, const InternedName& name) { return os << name.str(); }
 class Subject {
 private:
-    std::string name_;
-    int difficulty_;
-    int importance_;
-    double perfScore_;
-    double allocatedHours_;
-    std::vector<double> historyScores_;
+    InternedName name_;
+    int difficulty_;
+    int importance_;
+    double perfScore_;
+    double allocatedHours_;
+    int dueDay_ = kNoDueDay;
+    ScoreHistory history_;
+public:
+    Subject() : difficulty_(5), importance_(5),
+                perfScore_(100.0), allocatedHours_(0.0) {}
+    Subject(InternedName name, int difficulty, int importance, double perfScore = 100.0)
+        : name_(name),
+          difficulty_(clamp(difficulty, 1, 10)),
+          importance_(clamp(importance, 1, 10)),
+          perfScore_(clamp(perfScore, 0.0, 100.0)),
+          allocatedHours_(0.0) {}
+    Subject(const Subject& other) = default;
+    Subject(Subject&& other) = default;
+    Subject& operator=(const Subject& other) = default;
+    Subject& operator=(Subject&& other) = default;
+    const std::string& name() const { return name_.str(); }
+    std::string_view nameView() const { return name_.view(); }
+    const InternedName& internedName() const { return name_; }
+    NameId nameId() const { return name_.id(); }
+    int difficulty() const { return difficulty_; }
+    int importance() const { return importance_; }
+    double perfScore() const { return perfScore_; }
+    double allocatedHours() const { return allocatedHours_; }
+    int dueDay() const { return dueDay_; }
+    bool hasDueDay() const { return dueDay_ != kNoDueDay; }
+    const ScoreHistory& history() const { return history_; }
+    double priorityWeight() const { return priorityWeightOf(difficulty_, importance_, perfScore_); }
+    // Exam day as a day number on the planner's calendar; kNoDueDay clears it.
+    void setDueDay(int day) { dueDay_ = day < 0 ? kNoDueDay : day; }
+    void setAllocatedHours(double hrs) {
+        allocatedHours_ = std::max(0.0, hrs);
+    }
+    void updatePerformance(double newScore) {
+        history_.push(clamp(newScore, 0.0, 100.0));
+        perfScore_ = history_.mean();
+    }
+    void setPerformance(double score) {
+        perfScore_ = clamp(score, 0.0, 100.0);
+    }
+    // Replaces the history (oldest first) without touching perfScore; only the
+    // newest kScoreWindow scores are kept.
+    void restoreHistory(std::span<const double> scores) {
+        history_.clear();
+        if (scores.size() > kScoreWindow) scores = scores.last(kScoreWindow);
+        for (double v : scores) history_.push(clamp(v, 0.0, 100.0));
+    }
+    void restoreHistory(const ScoreHistory& history) { history_ = history; }
+    std::string toCSV() const {
+        std::ostringstream oss;
+        oss << name_ << "," << difficulty_ << "," << importance_ << "," << perfScore_ << "," << allocatedHours_;
+        if (hasDueDay()) oss << "," << dueDay_;
+        return oss.str();
+    }
+    static Subject fromCSV(const std::string& line) {
+        std::istringstream iss(line);
+        std::string tok;
+        std::vector<std::string> parts;
+        while (std::getline(iss, tok, ',')) parts.push_back(tok);
+        if (parts.size() < 5) throw std::runtime_error("Invalid subject CSV line");
+        const double perf = std::stod(parts[3]), hours = std::stod(parts[4]);
+        if (!std::isfinite(perf) || !std::isfinite(hours)) throw std::runtime_error("Invalid subject CSV line");
+        Subject s(parts[0], std::stoi(parts[1]), std::stoi(parts[2]), perf);
+        s.setAllocatedHours(hours);
+        if (parts.size() > 5 && !parts[5].empty()) s.setDueDay(std::stoi(parts[5]));
+        return s;
+    }
+    std::string summary() const {
+        std::string out;
+        appendSummary(out);
+        return out;
+    }
+    void appendSummary(std::string& out) const {
+        appendPadded(out, name_, 15);
+        out += " | diff: ";
+        std::size_t start = out.size();
+        appendInt(out, difficulty_);
+        padField(out, start, 2);
+        out += " imp: ";
+        start = out.size();
+        appendInt(out, importance_);
+        padField(out, start, 2);
+        out += " perf: ";
+        start = out.size();
+        appendFixed(out, perfScore_, 1);
+        padField(out, start, 6);
+        out += " hrs: ";
+        start = out.size();
+        appendFixed(out, allocatedHours_, 2);
+        padField(out, start, 5);
+        if (hasDueDay()) {
+            out += " exam: day ";
+            appendInt(out, dueDay_);
+        }
+    }
+};
+void appendScheduleHeader(std::string& out, double totalHours) {
+    out += "Schedule (total ";
+    appendFixed(out, totalHours, 2);
+    out += " hrs):\n";
+}
+void appendScheduleRow(std::string& out, std::string_view name, double hours) {
+    out += "  - ";
+    appendPadded(out, name, 15);
+    out += " -> ";
+    appendFixed(out, hours, 2);
+    out += " hrs\n";
+}
+void appendCompactRow(std::string& out, std::string_view name, double hours) {
+    out += name;
+    out += '\t';
+    appendFixed(out, hours, 2);
+    out += '\n';
+}
+struct Schedule {
+    std::map<InternedName, double> alloc;
+    Schedule() = default;
+    double totalHours() const {
+        double sum = 0.0;
+        for (const auto& kv : alloc) sum += kv.second;
+        return sum;
+    }
+    // Both maps are sorted by name, so the merge walks them together.
+    Schedule& operator+=(const Schedule& other) {
+        auto hint = alloc.begin();
+        for (const auto& kv : other.alloc) {
+            while (hint != alloc.end() && hint->first < kv.first) ++hint;
+            if (hint != alloc.end() && hint->first == kv.first) hint->second += kv.second;
+            else hint = alloc.emplace_hint(hint, kv.first, 0.0 + kv.second);
+        }
+        return *this;
+    }
+    friend Schedule operator+(Schedule lhs, const Schedule& rhs) { return std::move(lhs += rhs); }
+    std::string toString() const {
+        std::string out;
+        appendTo(out);
+        return out;
+    }
+    void appendTo(std::string& out) const {
+        appendScheduleHeader(out, totalHours());
+        for (const auto& kv : alloc) appendScheduleRow(out, kv.first, kv.second);
+    }
+    // One "name\thours" line per subject: the compact format for machines.
+    void appendCompact(std::string& out) const {
+        for (const auto& kv : alloc) appendCompactRow(out, kv.first, kv.second);
+    }
+};
+// Subject names of one planner (in planner order) shared by the FlatSchedules
+// generated from it; a new layout is made only when subjects are added or removed.
+// The name order is sorted once, on first use, for all of them.
+class ScheduleLayout {
+private:
+    std::vector<InternedName> names_;
+    mutable std::once_flag sortOnce_;
+    mutable std::vector<std::size_t> sorted_;
+public:
+    explicit ScheduleLayout(std::vector<InternedName> names) : names_(std::move(names)) {}
+    explicit ScheduleLayout(const std::vector<std::string>& names) : names_(names.begin(), names.end()) {}
+    std::size_t size() const { return names_.size(); }
+    std::string_view name(std::size_t i) const { return names_[i].view(); }
+    const InternedName& internedName(std::size_t i) const { return names_[i]; }
+    bool sameNames(const ScheduleLayout& other) const { return names_ == other.names_; }
+    // Slot indices in name order.
+    const std::vector<std::size_t>& sortedOrder() const {
+        std::call_once(sortOnce_, [&] {
+            sorted_.resize(size());
+            std::iota(sorted_.begin(), sorted_.end(), std::size_t(0));
+            std::sort(sorted_.begin(), sorted_.end(), [&](std::size_t a, std::size_t b) { return name(a) < name(b); });
+        });
+        return sorted_;
+    }
+};
+// Schedule stored as one hours value per layout slot. Summing schedules of the
+// same planner is a vector add; names are only looked at when rendering or
+// when adding schedules with different layouts.
+class FlatSchedule {
+private:
+    std::shared_ptr<const ScheduleLayout> layout_;
+    std::vector<double> hours_;
+public:
+    FlatSchedule() = default;
+    FlatSchedule(std::shared_ptr<const ScheduleLayout> layout, std::vector<double> hours)
+        : layout_(std::move(layout)), hours_(std::move(hours)) {
+        if ((layout_ ? layout_->size() : 0) != hours_.size())
+            throw std::runtime_error("Schedule hours do not match its layout");
+    }
+    std::size_t size() const { return hours_.size(); }
+    std::string_view name(std::size_t i) const { return layout_->name(i); }
+    double hours(std::size_t i) const { return hours_[i]; }
+    const std::vector<double>& hours() const { return hours_; }
+    const std::shared_ptr<const ScheduleLayout>& layout() const { return layout_; }
+    // Slot indices in name order, the order Schedule iterates in; sorted once per layout.
+    const std::vector<std::size_t>& sortedOrder() const {
+        static const std::vector<std::size_t> none;
+        return layout_ ? layout_->sortedOrder() : none;
+    }
+    // Summed in name order, so it matches Schedule::totalHours bit for bit.
+    double totalHours() const {
+        double sum = 0.0;
+        for (std::size_t i : sortedOrder()) sum += hours_[i];
+        return sum;
+    }
+    FlatSchedule& operator+=(const FlatSchedule& other) {
+        if (other.size() == 0) return *this;
+        if (size() == 0) return *this = other;
+        if (layout_ == other.layout_ || layout_->sameNames(*other.layout_)) {
+            for (std::size_t i = 0; i < hours_.size(); ++i) hours_[i] += other.hours_[i];
+            return *this;
+        }
+        std::unordered_map<NameId, std::size_t> slot;
+        std::vector<InternedName> names;
+        for (std::size_t i = 0; i < size(); ++i) {
+            slot.emplace(layout_->internedName(i).id(), i);
+            names.push_back(layout_->internedName(i));
+        }
+        for (std::size_t j = 0; j < other.size(); ++j) {
+            auto [it, inserted] = slot.emplace(other.layout_->internedName(j).id(), hours_.size());
+            if (inserted) {
+                names.push_back(other.layout_->internedName(j));
+                hours_.push_back(0.0);
+            }
+            hours_[it->second] += other.hours_[j];
+        }
+        layout_ = std::make_shared<const ScheduleLayout>(std::move(names));
+        return *this;
+    }
+    friend FlatSchedule operator+(FlatSchedule lhs, const FlatSchedule& rhs) { return std::move(lhs += rhs); }
+    Schedule toSchedule() const {
+        Schedule sch;
+        for (std::size_t i = 0; i < size(); ++i) sch.alloc.emplace(layout_->internedName(i), hours_[i]);
+        return sch;
+    }
+    std::string toString() const {
+        std::string out;
+        appendTo(out);
+        return out;
+    }
+    void appendTo(std::string& out) const {
+        const std::vector<std::size_t>& order = sortedOrder();
+        double total = 0.0;
+        std::size_t chars = 32;
+        for (std::size_t i : order) {
+            total += hours_[i];
+            chars += std::max<std::size_t>(name(i).size(), 15) + 16;
+        }
+        out.reserve(out.size() + chars);
+        appendScheduleHeader(out, total);
+        for (std::size_t i : order) appendScheduleRow(out, name(i), hours_[i]);
+    }
+    void appendCompact(std::string& out) const {
+        for (std::size_t i : sortedOrder()) appendCompactRow(out, name(i), hours_[i]);
+    }
+};
+// Timetable for a run of days: each day is a row of slotHours-sized slots, and
+// each subject's slots within a day are one contiguous block.
+struct HorizonBlock {
+    std::size_t subject;
+    int firstSlot;
+    int slots;
+};
+class HorizonPlan {
+private:
+    std::shared_ptr<const ScheduleLayout> layout_;
+    double slotHours_ = 0.25;
+    std::vector<int> daySlots_;
+    std::vector<std::size_t> dayBegin_{0};
+    std::vector<HorizonBlock> blocks_;
+public:
+    HorizonPlan() = default;
+    // Splits the horizon's slots between subjects by weight (largest remainder,
+    // at least one slot each while there are enough), then deals the slots out
+    // over the days in one pass.
+    HorizonPlan(std::shared_ptr<const ScheduleLayout> layout, const double* weights, std::size_t n,
+                std::span<const double> dayHours, double slotHours = 0.25)
+        : layout_(std::move(layout)), slotHours_(slotHours) {
+        if (!(slotHours > 0.0)) throw std::runtime_error("Slot length must be positive");
+        if (layout_ && layout_->size() != n) throw std::runtime_error("Weights do not match the layout");
+        long long totalSlots = 0;
+        daySlots_.reserve(dayHours.size());
+        for (double h : dayHours) {
+            int slots = h > 0.0 ? static_cast<int>(std::floor(h / slotHours + 1e-9)) : 0;
+            daySlots_.push_back(slots);
+            totalSlots += slots;
+        }
+        dayBegin_.reserve(dayHours.size() + 1);
+        if (n == 0 || totalSlots == 0) {
+            dayBegin_.assign(dayHours.size() + 1, 0);
+            return;
+        }
+        std::vector<long long> quota(n, 0);
+        double sumWeights = 0.0;
+        for (std::size_t i = 0; i < n; ++i) sumWeights += std::max(0.0, weights[i]);
+        {
+            std::vector<std::pair<double, std::size_t>> remainder(n);
+            long long given = 0;
+            for (std::size_t i = 0; i < n; ++i) {
+                double exact = sumWeights > 0.0 ? totalSlots * (std::max(0.0, weights[i]) / sumWeights)
+                                                : static_cast<double>(totalSlots) / n;
+                quota[i] = static_cast<long long>(exact);
+                given += quota[i];
+                remainder[i] = {exact - quota[i], i};
+            }
+            long long left = totalSlots - given;
+            std::size_t extra = static_cast<std::size_t>(std::clamp<long long>(left, 0, static_cast<long long>(n)));
+            std::partial_sort(remainder.begin(), remainder.begin() + extra, remainder.end(),
+                              [](const auto& a, const auto& b) { return a.first > b.first || (a.first == b.first && a.second < b.second); });
+            for (std::size_t k = 0; k < extra; ++k) ++quota[remainder[k].second];
+        }
+        if (totalSlots >= static_cast<long long>(n)) {
+            std::vector<std::pair<long long, std::size_t>> rich;
+            for (std::size_t i = 0; i < n; ++i) if (quota[i] > 1) rich.emplace_back(quota[i], i);
+            std::make_heap(rich.begin(), rich.end());
+            for (std::size_t i = 0; i < n; ++i) {
+                if (quota[i] != 0) continue;
+                std::pop_heap(rich.begin(), rich.end());
+                auto& top = rich.back();
+                --quota[top.second];
+                ++quota[i];
+                if (--top.first > 1) std::push_heap(rich.begin(), rich.end());
+                else rich.pop_back();
+            }
+        }
+        // Slots are handed out in timeline order; a subject's k-th slot ideally
+        // sits at (k + 0.5) / quota of the horizon, so a min-heap on that position
+        // spreads every subject evenly over the days (stride scheduling).
+        std::vector<std::pair<double, std::size_t>> heap;
+        std::vector<long long> next(n, 0);
+        heap.reserve(n);
+        for (std::size_t i = 0; i < n; ++i)
+            if (quota[i] > 0) heap.emplace_back(0.5 / quota[i], i);
+        auto later = [](const auto& a, const auto& b) { return a.first > b.first || (a.first == b.first && a.second > b.second); };
+        std::make_heap(heap.begin(), heap.end(), later);
+        std::vector<int> today(n, 0);
+        std::vector<std::size_t> touched;
+        for (int slots : daySlots_) {
+            touched.clear();
+            for (int k = 0; k < slots && !heap.empty(); ++k) {
+                std::pop_heap(heap.begin(), heap.end(), later);
+                std::size_t i = heap.back().second;
+                if (today[i]++ == 0) touched.push_back(i);
+                if (++next[i] < quota[i]) {
+                    heap.back().first = (next[i] + 0.5) / quota[i];
+                    std::push_heap(heap.begin(), heap.end(), later);
+                } else {
+                    heap.pop_back();
+                }
+            }
+            std::sort(touched.begin(), touched.end());
+            int slot = 0;
+            for (std::size_t i : touched) {
+                blocks_.push_back({i, slot, today[i]});
+                slot += today[i];
+                today[i] = 0;
+            }
+            dayBegin_.push_back(blocks_.size());
+        }
+    }
+    std::size_t days() const { return daySlots_.size(); }
+    double slotHours() const { return slotHours_; }
+    int slotsOn(std::size_t day) const { return daySlots_[day]; }
+    std::span<const HorizonBlock> day(std::size_t d) const {
+        return {blocks_.data() + dayBegin_[d], blocks_.data() + dayBegin_[d + 1]};
+    }
+    // Subject index in the given slot, or npos when the slot is free.
+    std::size_t subjectAt(std::size_t d, int slot) const {
+        for (const auto& b : day(d))
+            if (slot >= b.firstSlot && slot < b.firstSlot + b.slots) return b.subject;
+        return static_cast<std::size_t>(-1);
+    }
+    FlatSchedule daySchedule(std::size_t d) const {
+        std::vector<double> hours(layout_ ? layout_->size() : 0, 0.0);
+        for (const auto& b : day(d)) hours[b.subject] = b.slots * slotHours_;
+        return FlatSchedule(layout_, std::move(hours));
+    }
+    FlatSchedule totalSchedule() const {
+        std::vector<double> hours(layout_ ? layout_->size() : 0, 0.0);
+        for (const auto& b : blocks_) hours[b.subject] += b.slots * slotHours_;
+        return FlatSchedule(layout_, std::move(hours));
+    }
+    std::string toString() const {
+        std::string out;
+        appendTo(out);
+        return out;
+    }
+    void appendTo(std::string& out) const {
+        for (std::size_t d = 0; d < days(); ++d) {
+            out += "Day ";
+            appendInt(out, d + 1);
+            out += " (";
+            appendFixed(out, slotsOn(d) * slotHours_, 2);
+            out += " hrs):\n";
+            for (const auto& b : day(d)) {
+                out += "  ";
+                appendFixed(out, b.firstSlot * slotHours_, 2);
+                out += '-';
+                appendFixed(out, (b.firstSlot + b.slots) * slotHours_, 2);
+                out += "  ";
+                out += layout_->name(b.subject);
+                out += '\n';
+            }
+        }
+    }
+};
+enum class AllocationMode : std::uint32_t { Proportional = 0, Deadline = 1 };
+struct AdjustParams {
+    double lowThreshold = 70.0;
+    double highThreshold = 90.0;
+    double boostFactor = 1.15;
+    double reduceFactor = 0.9;
+};
+// Columnar subject storage: each field lives in its own contiguous array so the
+// scheduling passes stream through memory instead of chasing Subject pointers.
+class SubjectStore {
+private:
+    std::vector<NameId> names_;
+    std::vector<int> difficulty_;
+    std::vector<int> importance_;
+    std::vector<double> perfScore_;
+    std::vector<double> allocatedHours_;
+    std::vector<int> dueDay_;
+    std::vector<ScoreHistory> history_;
+public:
+    class SubjectRef {
+    private:
+        SubjectStore* store_;
+        std::size_t i_;
+    public:
+        SubjectRef(SubjectStore* store, std::size_t i) : store_(store), i_(i) {}
+        const std::string& name() const { return store_->nameAt(i_); }
+        int difficulty() const { return store_->difficulty_[i_]; }
+        int importance() const { return store_->importance_[i_]; }
+        double perfScore() const { return store_->perfScore_[i_]; }
+        double allocatedHours() const { return store_->allocatedHours_[i_]; }
+        int dueDay() const { return store_->dueDay_[i_]; }
+        const ScoreHistory& history() const { return store_->history_[i_]; }
+        double priorityWeight() const { return priorityWeightOf(difficulty(), importance(), perfScore()); }
+        void setDueDay(int day) { store_->dueDay_[i_] = day < 0 ? kNoDueDay : day; }
+        void setAllocatedHours(double hrs) { store_->allocatedHours_[i_] = std::max(0.0, hrs); }
+        void setPerformance(double score) { store_->perfScore_[i_] = clamp(score, 0.0, 100.0); }
+        void updatePerformance(double newScore) {
+            auto& h = store_->history_[i_];
+            h.push(clamp(newScore, 0.0, 100.0));
+            store_->perfScore_[i_] = h.mean();
+        }
+        Subject toSubject() const { return store_->subjectAt(i_); }
+    };
+    std::size_t size() const { return names_.size(); }
+    bool empty() const { return names_.empty(); }
+    void reserve(std::size_t n) {
+        names_.reserve(n); difficulty_.reserve(n); importance_.reserve(n);
+        perfScore_.reserve(n); allocatedHours_.reserve(n); dueDay_.reserve(n); history_.reserve(n);
+    }
+    void add(const Subject& s) {
+        names_.push_back(s.nameId());
+        difficulty_.push_back(s.difficulty());
+        importance_.push_back(s.importance());
+        perfScore_.push_back(s.perfScore());
+        allocatedHours_.push_back(s.allocatedHours());
+        dueDay_.push_back(s.dueDay());
+        history_.push_back(s.history());
+    }
+    void add(const std::string& name, int diff, int imp, double perf = 100.0) { add(Subject(name, diff, imp, perf)); }
+    SubjectRef operator[](std::size_t i) { return SubjectRef(this, i); }
+    Subject subjectAt(std::size_t i) const {
+        Subject s(InternedName(names_[i]), difficulty_[i], importance_[i], perfScore_[i]);
+        s.setAllocatedHours(allocatedHours_[i]);
+        s.setDueDay(dueDay_[i]);
+        s.restoreHistory(history_[i]);
+        return s;
+    }
+    const int* difficulties() const { return difficulty_.data(); }
+    const int* dueDays() const { return dueDay_.data(); }
+    const int* importances() const { return importance_.data(); }
+    const double* perfScores() const { return perfScore_.data(); }
+    const double* allocatedHours() const { return allocatedHours_.data(); }
+    const std::string& nameAt(std::size_t i) const { return NameInterner::global().name(names_[i]); }
+    NameId nameIdAt(std::size_t i) const { return names_[i]; }
+    const ScoreHistory& historyAt(std::size_t i) const { return history_[i]; }
+    // Schedules subjects [first, first + count) as one planner; returns the hours allocated.
+    template <WeightingPolicy Policy = DefaultWeighting>
+    double generateRange(std::size_t first, std::size_t count, double totalHours) {
+        double* hours = allocatedHours_.data() + first;
+        computeWeightsWith<Policy>(difficulty_.data() + first, importance_.data() + first, perfScore_.data() + first, hours, count);
+        proportionalAllocate(hours, count, totalHours);
+        return std::accumulate(hours, hours + count, 0.0);
+    }
+    template <WeightingPolicy Policy = DefaultWeighting>
+    double deadlineRange(std::size_t first, std::size_t count, double totalHours, int today) {
+        double* hours = allocatedHours_.data() + first;
+        computeWeightsWith<Policy>(difficulty_.data() + first, importance_.data() + first, perfScore_.data() + first, hours, count);
+        for (std::size_t i = 0; i < count; ++i) hours[i] = deadlineUrgency(hours[i], dueDay_[first + i], today);
+        deadlineAllocate(hours, count, totalHours);
+        return std::accumulate(hours, hours + count, 0.0);
+    }
+    double adjustRange(std::size_t first, std::size_t count, double totalHours, const AdjustParams& params) {
+        double* hours = allocatedHours_.data() + first;
+        adaptiveRescale(perfScore_.data() + first, hours, count, totalHours, params.lowThreshold,
+                        params.highThreshold, params.boostFactor, params.reduceFactor);
+        return std::accumulate(hours, hours + count, 0.0);
+    }
+    template <WeightingPolicy Policy = DefaultWeighting>
+    void generateSchedule(double totalHours) { generateRange<Policy>(0, size(), totalHours); }
+    void adaptiveAdjust(double totalHours, double lowThreshold = 70.0, double highThreshold = 90.0,
+                        double boostFactor = 1.15, double reduceFactor = 0.9) {
+        adjustRange(0, size(), totalHours, {lowThreshold, highThreshold, boostFactor, reduceFactor});
+    }
+    Schedule toSchedule() const {
+        Schedule sch;
+        for (std::size_t i = 0; i < size(); ++i) sch.alloc.emplace_hint(sch.alloc.end(), InternedName(names_[i]), allocatedHours_[i]);
+        return sch;
+    }
+};
+// Binary planner snapshot. A 64-byte header is followed by fixed-layout
+// sections whose positions follow from the header counts alone:
+//   double perfScore[n], double allocatedHours[n], double history[h],
+//   uint64 historyOffsets[n + 1], uint64 nameOffsets[n + 1],
+//   int32 difficulty[n], int32 importance[n], int32 dueDay[n] (version 2+),
+//   char names[bytes]
+// Every section starts on an 8-byte boundary. Values are stored in host byte
+// order, and the endian tag rejects files written on the other byte order.
+struct SnapshotHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t endianTag;
+    std::uint64_t subjectCount;
+    std::uint64_t historyCount;
+    std::uint64_t nameBytes;
+    double totalDailyHours;
+    std::int32_t currentDay;
+    std::uint32_t allocationMode;
+    std::uint64_t journalLsn;
+};
+static_assert(sizeof(SnapshotHeader) == 64, "snapshot header must stay 64 bytes");
+constexpr char kSnapshotMagic[8] = {'S', 'S', 'P', 'S', 'N', 'A', 'P', '\0'};
+constexpr std::uint32_t kSnapshotVersion = 2;
+constexpr std::uint32_t kSnapshotEndianTag = 0x01020304u;
+struct SnapshotLayout {
+    std::uint64_t perfScore, allocatedHours, history, historyOffsets, nameOffsets,
+                  difficulty, importance, dueDay, names, fileSize;
+    explicit SnapshotLayout(const SnapshotHeader& h) {
+        auto align8 = [](std::uint64_t v) { return (v + 7) & ~std::uint64_t(7); };
+        const std::uint64_t n = h.subjectCount;
+        perfScore = sizeof(SnapshotHeader);
+        allocatedHours = perfScore + 8 * n;
+        history = allocatedHours + 8 * n;
+        historyOffsets = history + 8 * h.historyCount;
+        nameOffsets = historyOffsets + 8 * (n + 1);
+        difficulty = nameOffsets + 8 * (n + 1);
+        importance = align8(difficulty + 4 * n);
+        dueDay = align8(importance + 4 * n);
+        names = h.version >= 2 ? align8(dueDay + 4 * n) : dueDay;
+        fileSize = names + h.nameBytes;
+    }
+};
+// Writes a snapshot at the stream's current position; offsets are relative to it.
+void writeSnapshot(std::ostream& os, const SubjectStore& store, double totalDailyHours,
+                   int currentDay = 0, AllocationMode mode = AllocationMode::Proportional,
+                   std::uint64_t journalLsn = 0) {
+    const std::size_t n = store.size();
+    std::vector<std::uint64_t> historyOffsets(n + 1, 0), nameOffsets(n + 1, 0);
+    for (std::size_t i = 0; i < n; ++i) {
+        historyOffsets[i + 1] = historyOffsets[i] + store.historyAt(i).size();
+        nameOffsets[i + 1] = nameOffsets[i] + store.nameAt(i).size();
+    }
+    SnapshotHeader h{};
+    std::memcpy(h.magic, kSnapshotMagic, sizeof h.magic);
+    h.version = kSnapshotVersion;
+    h.endianTag = kSnapshotEndianTag;
+    h.subjectCount = n;
+    h.historyCount = historyOffsets[n];
+    h.nameBytes = nameOffsets[n];
+    h.totalDailyHours = totalDailyHours;
+    h.currentDay = currentDay;
+    h.allocationMode = static_cast<std::uint32_t>(mode);
+    h.journalLsn = journalLsn;
+    const SnapshotLayout layout(h);
+    const std::uint64_t start = static_cast<std::uint64_t>(os.tellp());
+    auto put = [&](const void* data, std::size_t bytes) { os.write(static_cast<const char*>(data), bytes); };
+    auto padTo = [&](std::uint64_t offset) {
+        static const char zeros[8] = {};
+        put(zeros, offset - (static_cast<std::uint64_t>(os.tellp()) - start));
+    };
+    put(&h, sizeof h);
+    put(store.perfScores(), 8 * n);
+    put(store.allocatedHours(), 8 * n);
+    for (std::size_t i = 0; i < n; ++i) {
+        double scores[kScoreWindow];
+        store.historyAt(i).copyTo(scores);
+        put(scores, 8 * store.historyAt(i).size());
+    }
+    put(historyOffsets.data(), 8 * (n + 1));
+    put(nameOffsets.data(), 8 * (n + 1));
+    put(store.difficulties(), 4 * n);
+    padTo(layout.importance);
+    put(store.importances(), 4 * n);
+    padTo(layout.dueDay);
+    put(store.dueDays(), 4 * n);
+    padTo(layout.names);
+    for (std::size_t i = 0; i < n; ++i) put(store.nameAt(i).data(), store.nameAt(i).size());
+}
+void writeSnapshot(const std::string& filename, const SubjectStore& store, double totalDailyHours,
+                   int currentDay = 0, AllocationMode mode = AllocationMode::Proportional,
+                   std::uint64_t journalLsn = 0) {
+    SSP_METRIC_SCOPE(SaveFile, store.size());
+    std::ofstream ofs(filename, std::ios::binary | std::ios::trunc);
+    if (!ofs) throw std::runtime_error("Unable to open file for writing: " + filename);
+    writeSnapshot(ofs, store, totalDailyHours, currentDay, mode, journalLsn);
+    if (!ofs.flush()) throw std::runtime_error("Failed writing snapshot: " + filename);
+}
+// Read-only contents of a whole file, mapped where mmap is available and read
+// in one go otherwise; 8-byte aligned either way.
+class MappedFile {
+private:
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+    std::vector<std::uint64_t> buffer_;
+    bool mapped_ = false;
+    void reset() {
+#if defined(SSP_HAVE_MMAP)
+        if (mapped_) munmap(const_cast<char*>(data_), size_);
+#endif
+        mapped_ = false;
+        data_ = nullptr;
+        size_ = 0;
+        buffer_.clear();
+    }
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& filename) {
+#if defined(SSP_HAVE_MMAP)
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("Unable to open file for reading: " + filename);
+        struct stat st{};
+        if (fstat(fd, &st) != 0) { ::close(fd); throw std::runtime_error("Unable to stat file: " + filename); }
+        size_ = static_cast<std::size_t>(st.st_size);
+        if (size_ > 0) {
+            void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (p == MAP_FAILED) throw std::runtime_error("Unable to map file: " + filename);
+            data_ = static_cast<const char*>(p);
+            mapped_ = true;
+        } else {
+            ::close(fd);
+        }
+#else
+        std::ifstream ifs(filename, std::ios::binary | std::ios::ate);
+        if (!ifs) throw std::runtime_error("Unable to open file for reading: " + filename);
+        size_ = static_cast<std::size_t>(ifs.tellg());
+        buffer_.resize((size_ + 7) / 8);
+        ifs.seekg(0);
+        if (!ifs.read(reinterpret_cast<char*>(buffer_.data()), static_cast<std::streamsize>(size_)))
+            throw std::runtime_error("Failed reading file: " + filename);
+        data_ = reinterpret_cast<const char*>(buffer_.data());
+#endif
+    }
+    MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            reset();
+            std::swap(data_, other.data_);
+            std::swap(size_, other.size_);
+            std::swap(mapped_, other.mapped_);
+            buffer_.swap(other.buffer_);
+        }
+        return *this;
+    }
+    ~MappedFile() { reset(); }
+    const char* data() const { return data_; }
+    std::size_t size() const { return size_; }
+};
+// Read-only view of a snapshot file. The file is mapped (or read in one go
+// where mmap is unavailable) and the columns are used in place; names and
+// histories are only turned into strings/vectors when a caller asks.
+class SnapshotView {
+private:
+    MappedFile file_;
+    const char* base_ = nullptr;
+    std::size_t size_ = 0;
+    SnapshotHeader header_{};
+    const double* perf_ = nullptr;
+    const double* hours_ = nullptr;
+    const double* history_ = nullptr;
+    const std::uint64_t* historyOffsets_ = nullptr;
+    const std::uint64_t* nameOffsets_ = nullptr;
+    const std::int32_t* difficulty_ = nullptr;
+    const std::int32_t* importance_ = nullptr;
+    const std::int32_t* dueDay_ = nullptr;
+    const char* names_ = nullptr;
+    void attach(const std::string& what) {
+        if (size_ < sizeof(SnapshotHeader)) throw std::runtime_error("Not a planner snapshot: " + what);
+        std::memcpy(&header_, base_, sizeof header_);
+        if (std::memcmp(header_.magic, kSnapshotMagic, sizeof header_.magic) != 0)
+            throw std::runtime_error("Not a planner snapshot: " + what);
+        if (header_.endianTag != kSnapshotEndianTag)
+            throw std::runtime_error("Snapshot written with a different byte order: " + what);
+        if (header_.version < 1 || header_.version > kSnapshotVersion)
+            throw std::runtime_error("Unsupported snapshot version " + std::to_string(header_.version));
+        const SnapshotLayout layout(header_);
+        if (header_.subjectCount > size_ || header_.historyCount > size_ || header_.nameBytes > size_ ||
+            layout.fileSize > size_)
+            throw std::runtime_error("Truncated snapshot: " + what);
+        perf_ = reinterpret_cast<const double*>(base_ + layout.perfScore);
+        hours_ = reinterpret_cast<const double*>(base_ + layout.allocatedHours);
+        history_ = reinterpret_cast<const double*>(base_ + layout.history);
+        historyOffsets_ = reinterpret_cast<const std::uint64_t*>(base_ + layout.historyOffsets);
+        nameOffsets_ = reinterpret_cast<const std::uint64_t*>(base_ + layout.nameOffsets);
+        difficulty_ = reinterpret_cast<const std::int32_t*>(base_ + layout.difficulty);
+        importance_ = reinterpret_cast<const std::int32_t*>(base_ + layout.importance);
+        if (header_.version >= 2) dueDay_ = reinterpret_cast<const std::int32_t*>(base_ + layout.dueDay);
+        names_ = base_ + layout.names;
+        const std::size_t n = size();
+        if (historyOffsets_[0] != 0 || historyOffsets_[n] != header_.historyCount ||
+            nameOffsets_[0] != 0 || nameOffsets_[n] != header_.nameBytes)
+            throw std::runtime_error("Corrupt snapshot offsets: " + what);
+    }
+public:
+    explicit SnapshotView(const std::string& filename) : file_(filename), base_(file_.data()), size_(file_.size()) {
+        attach(filename);
+    }
+    // View over a snapshot held in memory by the caller (8-byte aligned), e.g.
+    // one record of a shard file.
+    SnapshotView(std::span<const char> bytes, const std::string& what) {
+        if (reinterpret_cast<std::uintptr_t>(bytes.data()) % 8 != 0)
+            throw std::runtime_error("Misaligned snapshot: " + what);
+        base_ = bytes.data();
+        size_ = bytes.size();
+        attach(what);
+    }
+    SnapshotView(const SnapshotView&) = delete;
+    SnapshotView& operator=(const SnapshotView&) = delete;
+    std::size_t size() const { return static_cast<std::size_t>(header_.subjectCount); }
+    double totalDailyHours() const { return header_.totalDailyHours; }
+    std::uint32_t version() const { return header_.version; }
+    int currentDay() const { return header_.version >= 2 ? header_.currentDay : 0; }
+    // Last journal record folded into this snapshot (0 if none).
+    std::uint64_t journalLsn() const { return header_.version >= 2 ? header_.journalLsn : 0; }
+    AllocationMode allocationMode() const {
+        return header_.version >= 2 && header_.allocationMode == static_cast<std::uint32_t>(AllocationMode::Deadline)
+                   ? AllocationMode::Deadline : AllocationMode::Proportional;
+    }
+    std::string_view name(std::size_t i) const {
+        if (nameOffsets_[i] > nameOffsets_[i + 1] || nameOffsets_[i + 1] > header_.nameBytes)
+            throw std::runtime_error("Corrupt snapshot name offsets");
+        return std::string_view(names_ + nameOffsets_[i], nameOffsets_[i + 1] - nameOffsets_[i]);
+    }
+    int difficulty(std::size_t i) const { return difficulty_[i]; }
+    int importance(std::size_t i) const { return importance_[i]; }
+    double perfScore(std::size_t i) const { return perf_[i]; }
+    double allocatedHours(std::size_t i) const { return hours_[i]; }
+    int dueDay(std::size_t i) const { return dueDay_ ? dueDay_[i] : kNoDueDay; }
+    std::span<const double> history(std::size_t i) const {
+        if (historyOffsets_[i] > historyOffsets_[i + 1] || historyOffsets_[i + 1] > header_.historyCount)
+            throw std::runtime_error("Corrupt snapshot history offsets");
+        return {history_ + historyOffsets_[i], static_cast<std::size_t>(historyOffsets_[i + 1] - historyOffsets_[i])};
+    }
+    const std::int32_t* difficulties() const { return difficulty_; }
+    const std::int32_t* importances() const { return importance_; }
+    const double* perfScores() const { return perf_; }
+    const double* allocatedHoursColumn() const { return hours_; }
+    Subject subjectAt(std::size_t i) const {
+        Subject s(name(i), difficulty(i), importance(i), perfScore(i));
+        s.setAllocatedHours(allocatedHours(i));
+        s.setDueDay(dueDay(i));
+        s.restoreHistory(history(i));
+        return s;
+    }
+};
+// Durable file helpers. syncFile flushes a closed file to stable storage;
+// replaceFile renames tmp over path and syncs the directory so the rename
+// itself survives a crash. Both degrade to plain I/O without POSIX fsync.
+void syncFile(const std::string& path) {
+#if defined(SSP_HAVE_FSYNC)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Unable to open file for syncing: " + path);
+    int rc = ::fsync(fd);
+    ::close(fd);
+    if (rc != 0) throw std::runtime_error("Unable to sync file: " + path);
+#else
+    (void)path;
+#endif
+}
+void syncParentDirectory(const std::string& path) {
+#if defined(SSP_HAVE_FSYNC)
+    std::string dir = std::filesystem::path(path).parent_path().string();
+    int fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+#else
+    (void)path;
+#endif
+}
+void replaceFile(const std::string& tmp, const std::string& path) {
+    std::error_code ec;
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) {
+        std::filesystem::remove(tmp, ec);
+        throw std::runtime_error("Unable to replace file: " + path);
+    }
+    syncParentDirectory(path);
+}
+// Writes the planner text format (same bytes as Subject::toCSV rows) to a temp
+// file next to path, fsyncs it and renames it over path, so readers see either
+// the old file or the complete new one.
+void writeSubjectFile(const std::string& path, const SubjectStore& store) {
+    SSP_METRIC_SCOPE(SaveFile, store.size());
+    static std::atomic<unsigned> tmpCounter{0};
+    const std::string tmp = path + ".tmp" + std::to_string(tmpCounter.fetch_add(1));
+    std::string out = "name,difficulty,importance,perfScore,allocatedHours,dueDay\n";
+    out.reserve(out.size() + store.size() * 48);
+    char num[32];
+    auto putInt = [&](int v) { out.append(num, std::to_chars(num, num + sizeof num, v).ptr); };
+    auto putDouble = [&](double v) { out.append(num, static_cast<std::size_t>(std::snprintf(num, sizeof num, "%g", v))); };
+    for (std::size_t i = 0; i < store.size(); ++i) {
+        out += store.nameAt(i);
+        out += ',';
+        putInt(store.difficulties()[i]);
+        out += ',';
+        putInt(store.importances()[i]);
+        out += ',';
+        putDouble(store.perfScores()[i]);
+        out += ',';
+        putDouble(store.allocatedHours()[i]);
+        if (store.dueDays()[i] != kNoDueDay) {
+            out += ',';
+            putInt(store.dueDays()[i]);
+        }
+        out += '\n';
+    }
+    {
+        std::unique_ptr<std::FILE, int (*)(std::FILE*)> file(std::fopen(tmp.c_str(), "wb"), &std::fclose);
+        if (!file) throw std::runtime_error("Unable to open file for writing: " + path);
+        bool ok = std::fwrite(out.data(), 1, out.size(), file.get()) == out.size() && std::fflush(file.get()) == 0;
+#if defined(SSP_HAVE_FSYNC)
+        ok = ok && ::fsync(::fileno(file.get())) == 0;
+#endif
+        if (!ok || std::fclose(file.release()) != 0) {
+            std::remove(tmp.c_str());
+            throw std::runtime_error("Failed writing file: " + path);
+        }
+    }
+    replaceFile(tmp, path);
+}
+// Writes subject files (writeSubjectFile) on one owned background thread, so
+// saves never outlive the writer: the destructor finishes the queue and joins.
+// Each save takes a sequence number. While a save to a path is still queued, a
+// newer one to the same path replaces it, and the stale entry is skipped by its
+// sequence number; the replaced caller's future completes with the newer write.
+// Saves to one path are therefore written in order and never overtake each
+// other. shared() is a process-wide instance, drained at exit.
+class AsyncFileWriter {
+private:
+    struct Job {
+        std::uint64_t seq = 0;
+        SubjectStore store;
+        std::vector<std::promise<void>> waiters;
+    };
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::deque<std::pair<std::string, std::uint64_t>> order_;   // (path, seq), oldest first
+    std::unordered_map<std::string, Job> queued_;               // newest save per path
+    std::uint64_t nextSeq_ = 0;
+    std::uint64_t superseded_ = 0;
+    bool busy_ = false;
+    bool stop_ = false;
+    std::thread worker_;
+    void loop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            wake_.wait(lock, [&] { return stop_ || !order_.empty(); });
+            if (order_.empty()) return;
+            auto [path, seq] = std::move(order_.front());
+            order_.pop_front();
+            auto it = queued_.find(path);
+            if (it == queued_.end() || it->second.seq != seq) continue;
+            Job job = std::move(queued_.extract(it).mapped());
+            busy_ = true;
+            lock.unlock();
+            std::exception_ptr error;
+            try {
+                writeSubjectFile(path, job.store);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            for (auto& waiter : job.waiters) {
+                if (error) waiter.set_exception(error);
+                else waiter.set_value();
+            }
+            lock.lock();
+            busy_ = false;
+            if (order_.empty()) idle_.notify_all();
+        }
+    }
+public:
+    AsyncFileWriter() : worker_([this] { loop(); }) {}
+    AsyncFileWriter(const AsyncFileWriter&) = delete;
+    AsyncFileWriter& operator=(const AsyncFileWriter&) = delete;
+    ~AsyncFileWriter() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_one();
+        worker_.join();
+    }
+    static AsyncFileWriter& shared() {
+        static AsyncFileWriter writer;
+        return writer;
+    }
+    // Queues store for path; the future reports completion or the write error.
+    std::future<void> save(std::string path, SubjectStore store) {
+        std::promise<void> done;
+        std::future<void> result = done.get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Job& job = queued_[path];
+            if (!job.waiters.empty()) ++superseded_;
+            job.seq = ++nextSeq_;
+            job.store = std::move(store);
+            job.waiters.push_back(std::move(done));
+            order_.emplace_back(std::move(path), job.seq);
+        }
+        wake_.notify_one();
+        return result;
+    }
+    // Blocks until every save queued so far has been written.
+    void flush() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        idle_.wait(lock, [&] { return order_.empty() && !busy_; });
+    }
+    // Saves replaced by a newer one to the same path before being written.
+    std::uint64_t supersededSaves() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return superseded_;
+    }
+};
+// CRC-32 (IEEE, reflected); crc32(b, crc32(a)) == crc32(a + b).
+std::uint32_t crc32(const void* data, std::size_t n, std::uint32_t crc = 0) {
+    static const auto table = [] {
+        std::array<std::uint32_t, 256> t{};
+        for (std::uint32_t i = 0; i < 256; ++i) {
+            std::uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    const auto* p = static_cast<const unsigned char*>(data);
+    crc = ~crc;
+    for (std::size_t i = 0; i < n; ++i) crc = table[(crc ^ p[i]) & 0xFFu] ^ (crc >> 8);
+    return ~crc;
+}
+// Append-only log of planner mutations. Each record is
+//   uint32 payloadBytes, uint32 crc32(lsn + payload), uint64 lsn, payload
+// with payload = uint8 op, uint32 nameBytes, name, then the op's fields, all in
+// host byte order. Records are buffered and written + fsynced in batches, so a
+// crash loses at most the records since the last sync(); a torn or corrupt
+// tail is cut off when the log is replayed.
+enum class JournalOp : std::uint8_t { AddSubject = 1, RemoveSubject = 2, RecordPerformance = 3, SetTotalDailyHours = 4 };
+struct JournalRecord {
+    std::uint64_t lsn = 0;
+    JournalOp op = JournalOp::AddSubject;
+    std::string name;
+    int difficulty = 0;
+    int importance = 0;
+    double value = 0.0;   // perfScore, score or hours, depending on op
+};
+// Both sync limits are checked as records are appended; there is no timer, so
+// a writer that goes quiet must call sync() itself to make its last records
+// durable.
+struct JournalOptions {
+    std::size_t syncEveryRecords = 64;
+    std::chrono::milliseconds syncInterval{50};
+    std::uint64_t compactAfterRecords = 100000;
+};
+class PlannerJournal {
+private:
+    static constexpr std::size_t kHeaderBytes = 16;
+    static constexpr std::uint32_t kMaxPayload = 1u << 20;
+    std::string path_;
+    JournalOptions options_;
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> file_{nullptr, &std::fclose};
+    std::vector<char> buffer_;
+    std::uint64_t nextLsn_;
+    std::uint64_t durableLsn_;
+    std::size_t pending_ = 0;
+    std::chrono::steady_clock::time_point lastSync_ = std::chrono::steady_clock::now();
+    template <typename T>
+    static void putRaw(std::vector<char>& out, const T& v) {
+        const char* p = reinterpret_cast<const char*>(&v);
+        out.insert(out.end(), p, p + sizeof v);
+    }
+    static bool parse(const char* p, std::size_t n, JournalRecord& rec) {
+        auto take = [&](void* out, std::size_t bytes) {
+            if (bytes > n) return false;
+            std::memcpy(out, p, bytes);
+            p += bytes;
+            n -= bytes;
+            return true;
+        };
+        std::uint8_t op;
+        std::uint32_t nameBytes;
+        if (!take(&op, 1) || !take(&nameBytes, 4) || nameBytes > n) return false;
+        rec.op = static_cast<JournalOp>(op);
+        rec.name.assign(p, nameBytes);
+        p += nameBytes;
+        n -= nameBytes;
+        std::int32_t d = 0, i = 0;
+        switch (rec.op) {
+            case JournalOp::AddSubject:
+                if (!take(&d, 4) || !take(&i, 4) || !take(&rec.value, 8)) return false;
+                rec.difficulty = d;
+                rec.importance = i;
+                break;
+            case JournalOp::RemoveSubject: break;
+            case JournalOp::RecordPerformance:
+            case JournalOp::SetTotalDailyHours:
+                if (!take(&rec.value, 8)) return false;
+                break;
+            default: return false;
+        }
+        return n == 0;
+    }
+public:
+    // Opens the log for appending; new records are numbered from nextLsn.
+    PlannerJournal(std::string path, std::uint64_t nextLsn, const JournalOptions& options = {})
+        : path_(std::move(path)), options_(options), nextLsn_(nextLsn), durableLsn_(nextLsn - 1) {
+        file_.reset(std::fopen(path_.c_str(), "ab"));
+        if (!file_) throw std::runtime_error("Unable to open journal: " + path_);
+    }
+    PlannerJournal(const PlannerJournal&) = delete;
+    PlannerJournal& operator=(const PlannerJournal&) = delete;
+    ~PlannerJournal() {
+        try { sync(); } catch (...) {}
+    }
+    const std::string& path() const { return path_; }
+    std::uint64_t lastLsn() const { return nextLsn_ - 1; }
+    std::uint64_t durableLsn() const { return durableLsn_; }
+    // Throws unless a record naming `name` fits within kMaxPayload; replay
+    // would take a longer one for a torn tail and cut the log there.
+    static void checkName(std::string_view name) {
+        constexpr std::size_t kMaxName = kMaxPayload - 1 - 4 - 16;   // op, name length, the largest op fields
+        if (name.size() > kMaxName)
+            throw std::runtime_error("Name too long for the journal: " + std::to_string(name.size()) + " bytes");
+    }
+    // Buffers the record under the next LSN and syncs once the batch is full or old enough.
+    std::uint64_t append(const JournalRecord& rec) {
+        checkName(rec.name);
+        const std::uint64_t lsn = nextLsn_++;
+        const std::size_t start = buffer_.size();
+        buffer_.resize(start + kHeaderBytes);
+        putRaw(buffer_, static_cast<std::uint8_t>(rec.op));
+        putRaw(buffer_, static_cast<std::uint32_t>(rec.name.size()));
+        buffer_.insert(buffer_.end(), rec.name.begin(), rec.name.end());
+        switch (rec.op) {
+            case JournalOp::AddSubject:
+                putRaw(buffer_, static_cast<std::int32_t>(rec.difficulty));
+                putRaw(buffer_, static_cast<std::int32_t>(rec.importance));
+                putRaw(buffer_, rec.value);
+                break;
+            case JournalOp::RemoveSubject: break;
+            case JournalOp::RecordPerformance:
+            case JournalOp::SetTotalDailyHours:
+                putRaw(buffer_, rec.value);
+                break;
+        }
+        const std::uint32_t payload = static_cast<std::uint32_t>(buffer_.size() - start - kHeaderBytes);
+        const std::uint32_t crc = crc32(buffer_.data() + start + kHeaderBytes, payload, crc32(&lsn, sizeof lsn));
+        std::memcpy(buffer_.data() + start, &payload, 4);
+        std::memcpy(buffer_.data() + start + 4, &crc, 4);
+        std::memcpy(buffer_.data() + start + 8, &lsn, 8);
+        if (++pending_ >= options_.syncEveryRecords ||
+            std::chrono::steady_clock::now() - lastSync_ >= options_.syncInterval)
+            sync();
+        return lsn;
+    }
+    // Writes out the buffered records and fsyncs the log.
+    void sync() {
+        if (!buffer_.empty()) {
+            if (std::fwrite(buffer_.data(), 1, buffer_.size(), file_.get()) != buffer_.size() ||
+                std::fflush(file_.get()) != 0)
+                throw std::runtime_error("Failed writing journal: " + path_);
+#if defined(SSP_HAVE_FSYNC)
+            if (::fsync(::fileno(file_.get())) != 0) throw std::runtime_error("Unable to sync journal: " + path_);
+#endif
+            buffer_.clear();
+        }
+        pending_ = 0;
+        durableLsn_ = lastLsn();
+        lastSync_ = std::chrono::steady_clock::now();
+    }
+    // Calls apply(const JournalRecord&) for each record with lsn > afterLsn, in
+    // order, and returns the highest LSN seen. Replay stops at the first torn or
+    // corrupt record and the file is truncated there.
+    template <typename Apply>
+    static std::uint64_t replay(const std::string& path, std::uint64_t afterLsn, Apply&& apply) {
+        std::unique_ptr<std::FILE, int (*)(std::FILE*)> file(std::fopen(path.c_str(), "rb"), &std::fclose);
+        if (!file) return 0;
+        std::uint64_t last = 0, good = 0;
+        std::vector<char> payload;
+        JournalRecord rec;
+        bool torn = false;
+        while (true) {
+            char header[kHeaderBytes];
+            std::size_t got = std::fread(header, 1, kHeaderBytes, file.get());
+            if (got == 0) break;
+            std::uint32_t bytes, crc;
+            std::memcpy(&bytes, header, 4);
+            std::memcpy(&crc, header + 4, 4);
+            std::memcpy(&rec.lsn, header + 8, 8);
+            if (got < kHeaderBytes || bytes > kMaxPayload) { torn = true; break; }
+            payload.resize(bytes);
+            if (std::fread(payload.data(), 1, bytes, file.get()) != bytes ||
+                crc32(payload.data(), bytes, crc32(&rec.lsn, sizeof rec.lsn)) != crc ||
+                rec.lsn <= last || !parse(payload.data(), bytes, rec)) {
+                torn = true;
+                break;
+            }
+            good += kHeaderBytes + bytes;
+            last = rec.lsn;
+            if (rec.lsn > afterLsn) apply(static_cast<const JournalRecord&>(rec));
+        }
+        file.reset();
+        if (torn) std::filesystem::resize_file(path, good);
+        return last;
+    }
+};
+// Streaming CSV import. The file is read in large chunks and split in place
+// into string_views; numbers go through std::from_chars (locale-independent).
+// Bad rows are counted and reported by line number instead of aborting.
+struct CsvSubjectRow {
+    std::string_view name;
+    int difficulty = 5;
+    int importance = 5;
+    double perfScore = 100.0;
+    double allocatedHours = 0.0;
+    int dueDay = kNoDueDay;
+};
+struct CsvRowError {
+    std::size_t line;
+    std::string message;
+};
+struct CsvImportReport {
+    std::size_t rows = 0;
+    std::size_t imported = 0;
+    std::size_t rejected = 0;
+    std::vector<CsvRowError> errors;
+};
+constexpr std::size_t kMaxCsvErrors = 1000;
+std::string_view trimField(std::string_view f) {
+    while (!f.empty() && (f.front() == ' ' || f.front() == '\t')) f.remove_prefix(1);
+    while (!f.empty() && (f.back() == ' ' || f.back() == '\t')) f.remove_suffix(1);
+    return f;
+}
+// Parses a whole field; from_chars also reads nan and inf, which are refused
+// since no score, hours or count may be non-finite.
+template <typename T>
+bool parseField(std::string_view f, T& out) {
+    f = trimField(f);
+    if (!f.empty() && f.front() == '+') f.remove_prefix(1);
+    auto [ptr, ec] = std::from_chars(f.data(), f.data() + f.size(), out);
+    if (ec != std::errc() || ptr != f.data() + f.size() || f.empty()) return false;
+    if constexpr (std::is_floating_point_v<T>) return std::isfinite(out);
+    return true;
+}
+// Returns nullptr on success or a description of what is wrong with the row.
+const char* parseSubjectRow(std::string_view line, CsvSubjectRow& row) {
+    std::string_view fields[6];
+    std::size_t count = 0;
+    while (count < 6) {
+        std::size_t comma = line.find(',');
+        fields[count++] = line.substr(0, comma);
+        if (comma == std::string_view::npos) break;
+        line.remove_prefix(comma + 1);
+    }
+    if (count < 5) return "expected 5 fields";
+    row.name = fields[0];
+    if (!parseField(fields[1], row.difficulty)) return "invalid difficulty";
+    if (!parseField(fields[2], row.importance)) return "invalid importance";
+    if (!parseField(fields[3], row.perfScore)) return "invalid perfScore";
+    if (!parseField(fields[4], row.allocatedHours)) return "invalid allocatedHours";
+    if (count == 6 && !trimField(fields[5]).empty()) {
+        if (!parseField(fields[5], row.dueDay) || row.dueDay < 0) return "invalid dueDay";
+    }
+    return nullptr;
+}
+// Calls handle(std::string_view) for each line of the file (without the '\n'),
+// reading it in large chunks; what names the file in errors.
+template <typename Handle>
+void forEachLine(std::FILE* file, const std::string& what, Handle&& handle) {
+    std::vector<char> buf(std::size_t(1) << 20);
+    std::size_t carry = 0;
+    while (true) {
+        std::size_t got = std::fread(buf.data() + carry, 1, buf.size() - carry, file);
+        std::size_t avail = carry + got;
+        std::size_t start = 0;
+        while (const void* nl = std::memchr(buf.data() + start, '\n', avail - start)) {
+            std::size_t end = static_cast<std::size_t>(static_cast<const char*>(nl) - buf.data());
+            handle(std::string_view(buf.data() + start, end - start));
+            start = end + 1;
+        }
+        carry = avail - start;
+        if (got == 0) {
+            if (std::ferror(file)) throw std::runtime_error("Failed reading file: " + what);
+            if (carry > 0) handle(std::string_view(buf.data() + start, carry));
+            break;
+        }
+        if (start == 0 && carry == buf.size()) buf.resize(buf.size() * 2);
+        else std::memmove(buf.data(), buf.data() + start, carry);
+    }
+}
+// Calls onRow(const CsvSubjectRow&) for every well-formed data row; onRow
+// returns nullptr to accept the row or a message to reject it.
+template <typename OnRow>
+CsvImportReport readSubjectCSV(const std::string& filename, OnRow&& onRow) {
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> file(std::fopen(filename.c_str(), "rb"), &std::fclose);
+    if (!file) throw std::runtime_error("Unable to open file for reading: " + filename);
+    CsvImportReport report;
+    std::size_t lineNo = 0;
+    bool first = true;
+    auto reject = [&](std::size_t line, std::string message) {
+        ++report.rejected;
+        if (report.errors.size() < kMaxCsvErrors) report.errors.push_back({line, std::move(message)});
+    };
+    forEachLine(file.get(), filename, [&](std::string_view line) {
+        ++lineNo;
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (line.empty()) return;
+        if (first) {
+            first = false;
+            if (line.find("name,difficulty,importance") != std::string_view::npos) return;
+        }
+        ++report.rows;
+        CsvSubjectRow row;
+        const char* err = parseSubjectRow(line, row);
+        if (!err) err = onRow(static_cast<const CsvSubjectRow&>(row));
+        if (err) reject(lineNo, err);
+        else ++report.imported;
+    });
+    return report;
+}
+// Bookkeeping from the last full replan that lets one subject's weight change
+// in O(1). generateSchedule gives subject i
+//   round(max((w_i / S) * T, minSlot) * (T / R) * 100) / 100,
+// where S is the sum of weights and R the sum of the clamped shares. After an
+// update, the other subjects only differ through S and R. That holds as long as
+// no other subject crosses the minSlot clamp, which is checked against bounds on
+// the largest clamped and the smallest unclamped weight. Others' hours are
+// written back lazily.
+struct LivePlan {
+    static constexpr double kMinSlot = 0.25;
+    static constexpr std::size_t kResyncInterval = 4096;
+    bool valid = false;
+    bool pending = false;
+    std::vector<double> weights;
+    double totalHours = 0.0;
+    double sumWeights = 0.0;
+    double rawSum = 0.0;
+    double unclampedSum = 0.0;
+    double maxClamped = -std::numeric_limits<double>::infinity();
+    double minUnclamped = std::numeric_limits<double>::infinity();
+    std::size_t clamped = 0;
+    std::size_t updates = 0;
+    bool isClamped(double w, double sum) const { return (w / sum) * totalHours < kMinSlot; }
+    double hoursFor(double w) const {
+        return std::round(std::max((w / sumWeights) * totalHours, kMinSlot) * (totalHours / rawSum) * 100.0) / 100.0;
+    }
+    // Called after a full replan with the weights it used.
+    void reset(double hours) {
+        *this = LivePlan{false, false, std::move(weights), hours};
+        sumWeights = std::accumulate(weights.begin(), weights.end(), 0.0);
+        if (!(sumWeights > 0.0) || !(totalHours > 0.0)) return;
+        for (double w : weights) {
+            rawSum += std::max((w / sumWeights) * totalHours, kMinSlot);
+            if (isClamped(w, sumWeights)) { ++clamped; maxClamped = std::max(maxClamped, w); }
+            else { unclampedSum += w; minUnclamped = std::min(minUnclamped, w); }
+        }
+        valid = true;
+    }
+    // Moves subject i to weight wNew; false means a full replan is needed.
+    bool update(std::size_t i, double wNew) {
+        if (!valid || ++updates > kResyncInterval) return false;
+        const double wOld = weights[i];
+        const double newSum = sumWeights - wOld + wNew;
+        if (!(newSum > 0.0)) return false;
+        if (!isClamped(maxClamped, newSum) || isClamped(minUnclamped, newSum)) return false;
+        if (isClamped(wOld, sumWeights)) --clamped;
+        else unclampedSum -= wOld;
+        if (isClamped(wNew, newSum)) { ++clamped; maxClamped = std::max(maxClamped, wNew); }
+        else { unclampedSum += wNew; minUnclamped = std::min(minUnclamped, wNew); }
+        weights[i] = wNew;
+        sumWeights = newSum;
+        rawSum = static_cast<double>(clamped) * kMinSlot + (unclampedSum / sumWeights) * totalHours;
+        pending = true;
+        return true;
+    }
+};
+// What-if view of a planner: changes layered over an immutable copy of it.
+// Every with*() call returns a new preview that shares the base, so a preview
+// costs O(changed) memory however many subjects the planner has. In
+// proportional mode, hours come from the same closed form as recordAndReplan
+// (see LivePlan). The base keeps its weights sorted with prefix sums, so a
+// new total or changed subjects are folded in in O(changed + log n), and
+// hoursFor is O(1). Deadline mode has no closed form: there, hoursFor and
+// schedule() replan the whole overlay. Nothing here touches the planner.
+class PlanPreview {
+private:
+    struct Base {
+        SubjectStore subjects;
+        std::shared_ptr<const ScheduleLayout> layout;
+        std::unordered_map<std::string_view, std::size_t, NameHash, std::equal_to<>> index;
+        std::vector<double> weights;  // planner order
+        std::vector<double> sorted;   // ascending, with prefix[k] the sum of the first k
+        std::vector<double> prefix;
+        double sumWeights = 0.0;
+        AllocationMode mode = AllocationMode::Proportional;
+        int currentDay = 0;
+    };
+    static constexpr double kMinSlot = LivePlan::kMinSlot;
+    std::shared_ptr<const Base> base_;
+    std::map<std::size_t, std::optional<Subject>> changed_;  // base index -> replacement, nullopt if removed
+    std::vector<Subject> added_;
+    std::size_t removed_ = 0;
+    double totalHours_ = 0.0;
+    double sumWeights_ = 0.0;
+    double rawSum_ = 0.0;
+    // Sums of the proportional plan with the overlay applied.
+    void refresh() {
+        const Base& b = *base_;
+        double sum = b.sumWeights;
+        for (const auto& [i, sub] : changed_) {
+            sum -= b.weights[i];
+            if (sub) sum += sub->priorityWeight();
+        }
+        for (const auto& s : added_) sum += s.priorityWeight();
+        sumWeights_ = sum;
+        rawSum_ = 0.0;
+        if (!(sum > 0.0)) return;
+        auto clamped = [&](double w) { return (w / sum) * totalHours_ < kMinSlot; };
+        std::size_t count = static_cast<std::size_t>(std::partition_point(b.sorted.begin(), b.sorted.end(), clamped) - b.sorted.begin());
+        double unclamped = b.prefix.back() - b.prefix[count];
+        auto fold = [&](double w, int sign) {
+            if (clamped(w)) count += static_cast<std::size_t>(sign);
+            else unclamped += sign * w;
+        };
+        for (const auto& [i, sub] : changed_) {
+            fold(b.weights[i], -1);
+            if (sub) fold(sub->priorityWeight(), 1);
+        }
+        for (const auto& s : added_) fold(s.priorityWeight(), 1);
+        rawSum_ = static_cast<double>(count) * kMinSlot + (unclamped / sum) * totalHours_;
+    }
+    double hoursForWeight(double w) const {
+        if (!(sumWeights_ > 0.0)) return totalHours_ / static_cast<double>(subjectCount());
+        return std::round(std::max((w / sumWeights_) * totalHours_, kMinSlot) *
+                          (rawSum_ > 0.0 ? totalHours_ / rawSum_ : 1.0) * 100.0) / 100.0;
+    }
+    // Calls fn(name, difficulty, importance, perfScore, dueDay) in schedule order.
+    template <typename Fn>
+    void forEachSubject(Fn&& fn) const {
+        const Base& b = *base_;
+        auto next = changed_.begin();
+        for (std::size_t i = 0; i < b.subjects.size(); ++i) {
+            if (next != changed_.end() && next->first == i) {
+                if (const auto& s = next->second) fn(s->nameView(), s->difficulty(), s->importance(), s->perfScore(), s->dueDay());
+                ++next;
+                continue;
+            }
+            fn(std::string_view(b.subjects.nameAt(i)), b.subjects.difficulties()[i], b.subjects.importances()[i],
+               b.subjects.perfScores()[i], b.subjects.dueDays()[i]);
+        }
+        for (const auto& s : added_) fn(s.nameView(), s.difficulty(), s.importance(), s.perfScore(), s.dueDay());
+    }
+    std::vector<double> deadlineHours() const {
+        std::vector<double> hours;
+        hours.reserve(subjectCount());
+        forEachSubject([&](std::string_view, int d, int imp, double perf, int due) {
+            hours.push_back(deadlineUrgency(priorityWeightOf(d, imp, perf), due, base_->currentDay));
+        });
+        deadlineAllocate(hours.data(), hours.size(), totalHours_);
+        return hours;
+    }
+    // Base index of a subject still in the preview, or npos.
+    std::size_t baseIndex(std::string_view name) const {
+        auto it = base_->index.find(name);
+        if (it == base_->index.end()) return std::string_view::npos;
+        auto c = changed_.find(it->second);
+        return c != changed_.end() && !c->second ? std::string_view::npos : it->second;
+    }
+    std::vector<Subject>::const_iterator findAdded(std::string_view name) const {
+        return std::find_if(added_.begin(), added_.end(), [&](const Subject& s) { return s.nameView() == name; });
+    }
+    // Copy-on-write access to one subject: the overlay entry, made on first change.
+    Subject& edit(std::string_view name) {
+        std::size_t i = baseIndex(name);
+        if (i != std::string_view::npos) {
+            auto c = changed_.find(i);
+            if (c == changed_.end()) c = changed_.emplace(i, base_->subjects.subjectAt(i)).first;
+            return *c->second;
+        }
+        auto a = findAdded(name);
+        if (a == added_.end()) throw std::runtime_error("Subject not found: " + std::string(name));
+        return added_[static_cast<std::size_t>(a - added_.begin())];
+    }
+public:
+    using BasePtr = std::shared_ptr<const Base>;
+    // The sorted base for a set of subjects; O(n log n). Previews built on
+    // the same base share it (StudyPlanner::whatIf keeps one per version).
+    static BasePtr makeBase(SubjectStore subjects, std::shared_ptr<const ScheduleLayout> layout,
+                            AllocationMode mode, int currentDay) {
+        auto b = std::make_shared<Base>();
+        b->subjects = std::move(subjects);
+        b->layout = std::move(layout);
+        b->mode = mode;
+        b->currentDay = currentDay;
+        const std::size_t n = b->subjects.size();
+        b->index.reserve(n);
+        b->weights.resize(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            b->index.emplace(b->subjects.nameAt(i), i);
+            b->weights[i] = priorityWeightOf(b->subjects.difficulties()[i], b->subjects.importances()[i],
+                                             b->subjects.perfScores()[i]);
+        }
+        b->sumWeights = std::accumulate(b->weights.begin(), b->weights.end(), 0.0);
+        b->sorted = b->weights;
+        std::sort(b->sorted.begin(), b->sorted.end());
+        b->prefix.resize(n + 1);
+        for (std::size_t i = 0; i < n; ++i) b->prefix[i + 1] = b->prefix[i] + b->sorted[i];
+        return b;
+    }
+    PlanPreview(BasePtr base, double totalDailyHours) : base_(std::move(base)), totalHours_(totalDailyHours) {
+        refresh();
+    }
+    PlanPreview(SubjectStore subjects, std::shared_ptr<const ScheduleLayout> layout, double totalDailyHours,
+                AllocationMode mode, int currentDay)
+        : PlanPreview(makeBase(std::move(subjects), std::move(layout), mode, currentDay), totalDailyHours) {}
+    std::size_t subjectCount() const { return base_->subjects.size() - removed_ + added_.size(); }
+    // Subjects the preview holds its own copy of (changed, removed or added).
+    std::size_t changedCount() const { return changed_.size() + added_.size(); }
+    double totalDailyHours() const { return totalHours_; }
+    PlanPreview withTotalDailyHours(double hrs) const {
+        requireHours(hrs);
+        PlanPreview p = *this;
+        p.totalHours_ = hrs;
+        p.refresh();
+        return p;
+    }
+    PlanPreview withScore(std::string_view name, double score) const {
+        PlanPreview p = *this;
+        p.edit(name).updatePerformance(score);
+        p.refresh();
+        return p;
+    }
+    PlanPreview withSubject(const std::string& name, int diff, int imp, double perf = 100.0) const {
+        if (contains(name)) throw std::runtime_error("Subject already exists: " + name);
+        PlanPreview p = *this;
+        p.added_.emplace_back(name, diff, imp, perf);
+        p.refresh();
+        return p;
+    }
+    PlanPreview withoutSubject(std::string_view name) const {
+        PlanPreview p = *this;
+        std::size_t i = baseIndex(name);
+        if (i != std::string_view::npos) {
+            p.changed_[i].reset();
+            ++p.removed_;
+        } else {
+            std::erase_if(p.added_, [&](const Subject& s) { return s.nameView() == name; });
+        }
+        p.refresh();
+        return p;
+    }
+    bool contains(std::string_view name) const {
+        return baseIndex(name) != std::string_view::npos || findAdded(name) != added_.end();
+    }
+    double hoursFor(std::string_view name) const {
+        const Base& b = *base_;
+        std::size_t pos = 0;
+        double w = 0.0;
+        if (std::size_t i = baseIndex(name); i != std::string_view::npos) {
+            auto c = changed_.lower_bound(i);
+            w = c != changed_.end() && c->first == i ? c->second->priorityWeight() : b.weights[i];
+            pos = i - static_cast<std::size_t>(std::count_if(changed_.begin(), c, [](const auto& e) { return !e.second; }));
+        } else {
+            auto a = findAdded(name);
+            if (a == added_.end()) throw std::runtime_error("Subject not found: " + std::string(name));
+            w = a->priorityWeight();
+            pos = b.subjects.size() - removed_ + static_cast<std::size_t>(a - added_.begin());
+        }
+        if (b.mode == AllocationMode::Deadline) return deadlineHours()[pos];
+        return hoursForWeight(w);
+    }
+    FlatSchedule schedule() const {
+        std::vector<double> hours;
+        if (base_->mode == AllocationMode::Deadline) {
+            hours = deadlineHours();
+        } else {
+            hours.reserve(subjectCount());
+            forEachSubject([&](std::string_view, int d, int imp, double perf, int) {
+                hours.push_back(hoursForWeight(priorityWeightOf(d, imp, perf)));
+            });
+        }
+        if (removed_ == 0 && added_.empty() && base_->layout) return FlatSchedule(base_->layout, std::move(hours));
+        std::vector<InternedName> names;
+        names.reserve(hours.size());
+        forEachSubject([&](std::string_view name, int, int, double, int) { names.emplace_back(name); });
+        return FlatSchedule(std::make_shared<const ScheduleLayout>(std::move(names)), std::move(hours));
+    }
+};
+// Content key of everything generateSchedule depends on: two independently
+// mixed 64-bit lanes over the daily total, mode, day and the ordered subjects.
+struct ScheduleKey {
+    std::uint64_t a = 0, b = 0;
+    bool operator==(const ScheduleKey&) const = default;
+};
+struct ScheduleKeyHash {
+    std::size_t operator()(const ScheduleKey& k) const noexcept { return static_cast<std::size_t>(k.a ^ (k.b >> 1)); }
+};
+class ScheduleKeyBuilder {
+private:
+    std::uint64_t a_ = 0x9e3779b97f4a7c15ull, b_ = 0xc2b2ae3d27d4eb4full;
+    static std::uint64_t mix(std::uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdull;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ull;
+        return x ^ (x >> 33);
+    }
+public:
+    void add(std::uint64_t w) {
+        a_ = mix(a_ ^ w) + 0x165667b19e3779f9ull;
+        b_ = std::rotl(b_ + w * 0x9fb21c651e98df25ull, 29) * 0x85ebca77c2b2ae63ull;
+    }
+    void add(double v) { add(std::bit_cast<std::uint64_t>(v)); }
+    void add(std::string_view s) {
+        add(static_cast<std::uint64_t>(s.size()));
+        for (std::size_t i = 0; i < s.size(); i += 8) {
+            std::uint64_t w = 0;
+            std::memcpy(&w, s.data() + i, std::min<std::size_t>(8, s.size() - i));
+            add(w);
+        }
+    }
+    ScheduleKey key() const { return {mix(a_), mix(b_)}; }
+};
+// Process-wide LRU of generated schedules by content key, so planners with the
+// same subjects (standard course bundles) share one computation. Disabled
+// until given a capacity; thread-safe.
+class ScheduleCache {
+public:
+    struct Entry {
+        std::shared_ptr<const Schedule> schedule;
+        std::shared_ptr<const std::vector<double>> hours;  // in subject order
+    };
+    explicit ScheduleCache(std::size_t capacity = 0) : capacity_(capacity) {}
+    ScheduleCache(const ScheduleCache&) = delete;
+    ScheduleCache& operator=(const ScheduleCache&) = delete;
+    static ScheduleCache& shared() {
+        static ScheduleCache cache;
+        return cache;
+    }
+    void setCapacity(std::size_t capacity) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        capacity_ = capacity;
+        evict();
+    }
+    std::size_t capacity() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return capacity_;
+    }
+    std::size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return map_.size();
+    }
+    std::uint64_t hits() const { return hits_.load(std::memory_order_relaxed); }
+    std::uint64_t misses() const { return misses_.load(std::memory_order_relaxed); }
+    std::optional<Entry> find(const ScheduleKey& key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (capacity_ == 0) return std::nullopt;
+        auto it = map_.find(key);
+        if (it == map_.end()) {
+            misses_.fetch_add(1, std::memory_order_relaxed);
+            return std::nullopt;
+        }
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return it->second->second;
+    }
+    void insert(const ScheduleKey& key, Entry entry) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (capacity_ == 0) return;
+        if (auto it = map_.find(key); it != map_.end()) {
+            it->second->second = std::move(entry);
+            lru_.splice(lru_.begin(), lru_, it->second);
+            return;
+        }
+        lru_.emplace_front(key, std::move(entry));
+        map_.emplace(key, lru_.begin());
+        evict();
+    }
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        map_.clear();
+        lru_.clear();
+    }
+private:
+    using List = std::list<std::pair<ScheduleKey, Entry>>;
+    mutable std::mutex mutex_;
+    std::size_t capacity_;
+    List lru_;
+    std::unordered_map<ScheduleKey, List::iterator, ScheduleKeyHash> map_;
+    std::atomic<std::uint64_t> hits_{0}, misses_{0};
+    void evict() {
+        while (map_.size() > capacity_) {
+            map_.erase(lru_.back().first);
+            lru_.pop_back();
+        }
+    }
+};
+// Per-planner memory for subjects, their names and the name index. Small
+// requests are carved out of geometrically growing blocks and recycled through
+// per-size free lists, so building a planner costs a handful of block
+// allocations and teardown frees only the blocks. Requests above kMaxSmall go
+// straight to the global heap. Only the owning planner allocates, but planner
+// copies share subjects, so the last release of one may free it on any thread:
+// frees push onto per-size lock-free stacks, which an allocation that finds its
+// own free list empty takes over whole.
+class SubjectArena : public std::pmr::memory_resource {
+private:
+    static constexpr std::size_t kGranule = alignof(std::max_align_t);
+    static constexpr std::size_t kMaxSmall = 512;
+    static constexpr std::size_t kMaxBlock = std::size_t(1) << 20;
+    struct FreeNode { FreeNode* next; };
+    struct Block { Block* next; };
+    FreeNode* free_[kMaxSmall / kGranule] = {};
+    std::atomic<FreeNode*> freed_[kMaxSmall / kGranule] = {};
+    Block* blocks_ = nullptr;
+    char* cur_ = nullptr;
+    char* end_ = nullptr;
+    std::size_t nextBlock_;
+    static std::size_t sizeClass(std::size_t bytes) { return (std::max<std::size_t>(bytes, 1) - 1) / kGranule; }
+    void* do_allocate(std::size_t bytes, std::size_t align) override {
+        if (bytes > kMaxSmall || align > kGranule) return ::operator new(bytes, std::align_val_t(align));
+        const std::size_t cls = sizeClass(bytes);
+        if (!free_[cls] && freed_[cls].load(std::memory_order_relaxed))
+            free_[cls] = freed_[cls].exchange(nullptr, std::memory_order_acquire);
+        if (FreeNode* n = free_[cls]) {
+            free_[cls] = n->next;
+            return n;
+        }
+        const std::size_t size = (cls + 1) * kGranule;
+        if (static_cast<std::size_t>(end_ - cur_) < size) {
+            const std::size_t header = (sizeof(Block) + kGranule - 1) / kGranule * kGranule;
+            auto* b = static_cast<Block*>(::operator new(nextBlock_));
+            b->next = blocks_;
+            blocks_ = b;
+            cur_ = reinterpret_cast<char*>(b) + header;
+            end_ = reinterpret_cast<char*>(b) + nextBlock_;
+            nextBlock_ = std::min(nextBlock_ * 2, kMaxBlock);
+        }
+        void* p = cur_;
+        cur_ += size;
+        return p;
+    }
+    void do_deallocate(void* p, std::size_t bytes, std::size_t align) override {
+        if (bytes > kMaxSmall || align > kGranule) {
+            ::operator delete(p, std::align_val_t(align));
+            return;
+        }
+        auto* n = static_cast<FreeNode*>(p);
+        std::atomic<FreeNode*>& head = freed_[sizeClass(bytes)];
+        n->next = head.load(std::memory_order_relaxed);
+        while (!head.compare_exchange_weak(n->next, n, std::memory_order_release, std::memory_order_relaxed)) {}
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+public:
+    explicit SubjectArena(std::size_t firstBlock = 4096) : nextBlock_(std::max<std::size_t>(firstBlock, 2 * kMaxSmall)) {}
+    SubjectArena(const SubjectArena&) = delete;
+    SubjectArena& operator=(const SubjectArena&) = delete;
+    ~SubjectArena() override {
+        while (blocks_) {
+            Block* next = blocks_->next;
+            ::operator delete(blocks_);
+            blocks_ = next;
+        }
+    }
+    std::pmr::memory_resource* resource() { return this; }
+};
+// Allocator over a shared SubjectArena. Copies keep the arena alive, so a
+// subject handed out by findSubject stays valid after its planner is gone,
+// and containers carry their arena along when moved or swapped.
+template <typename T>
+class ArenaAllocator {
+private:
+    std::shared_ptr<SubjectArena> arena_;
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+    explicit ArenaAllocator(std::shared_ptr<SubjectArena> arena) noexcept : arena_(std::move(arena)) {}
+    // Copied even when moved from: a moved-from allocator must still equal the copy.
+    ArenaAllocator(const ArenaAllocator&) noexcept = default;
+    ArenaAllocator& operator=(const ArenaAllocator&) noexcept = default;
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena_(other.arena()) {}
+    T* allocate(std::size_t n) { return static_cast<T*>(arena_->resource()->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T* p, std::size_t n) noexcept { arena_->resource()->deallocate(p, n * sizeof(T), alignof(T)); }
+    const std::shared_ptr<SubjectArena>& arena() const noexcept { return arena_; }
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const noexcept { return arena_ == other.arena(); }
+};
+// Input rows and outcome of the bulk mutations (addSubjects, removeSubjects,
+// recordPerformanceBatch). A bulk call validates the whole span first: if any
+// entry is rejected, errors lists them (by span index) and nothing is applied.
+struct SubjectSpec {
+    std::string_view name;
+    int difficulty = 5;
+    int importance = 5;
+    double perfScore = 100.0;
+};
+struct ScoreUpdate {
+    std::string_view name;
+    double score;
+};
+struct BulkError {
+    std::size_t index;
+    std::string message;
+};
+struct BulkReport {
+    std::size_t applied = 0;
+    std::size_t rejected = 0;
+    std::vector<BulkError> errors;   // the first kMaxBulkErrors rejections
+    bool ok() const { return rejected == 0; }
+};
+constexpr std::size_t kMaxBulkErrors = 1000;
+class StudyPlanner {
+private:
+    using SubjectIndex = std::unordered_map<std::string_view, std::size_t, NameHash, std::equal_to<>,
+                                            ArenaAllocator<std::pair<const std::string_view, std::size_t>>>;
+    std::shared_ptr<SubjectArena> arena_;   // null in a moved-from planner until it next adds a subject
+    std::vector<std::shared_ptr<Subject>> subjects_;
+    SubjectIndex index_;
+    double totalDailyHours_;
+    AllocationMode mode_ = AllocationMode::Proportional;
+    int currentDay_ = 0;
+    mutable LivePlan live_;
+    mutable std::shared_ptr<const ScheduleLayout> layout_;
+    // Bumped by every mutator, including every path that writes allocated
+    // hours (replans of any policy, memo and cache hits, incremental plans via
+    // their mutator). Subjects shared with a copy or handed out by
+    // findSubject can change behind the planner's back, so while they are
+    // shared the memo is checked against the content key as well, and the
+    // version moves once they are no longer shared (see aliased()).
+    mutable std::uint64_t version_ = 0;
+    mutable bool aliased_ = false;   // subjects may be shared; cleared by aliased()
+    struct ScheduleMemo {
+        bool valid = false;
+        std::uint64_t version = 0;
+        ScheduleKey key;
+        ScheduleCache::Entry entry;
+    } memo_;
+    // Base of whatIf(), kept on the same terms as memo_.
+    struct PreviewMemo {
+        std::uint64_t version = 0;
+        ScheduleKey key;
+        PlanPreview::BasePtr base;
+    };
+    mutable PreviewMemo preview_;
+    void touch() { ++version_; }
+    void swapState(StudyPlanner& other) noexcept {
+        using std::swap;
+        swap(arena_, other.arena_);
+        swap(subjects_, other.subjects_);
+        swap(index_, other.index_);
+        swap(totalDailyHours_, other.totalDailyHours_);
+        swap(mode_, other.mode_);
+        swap(currentDay_, other.currentDay_);
+        swap(live_, other.live_);
+        swap(layout_, other.layout_);
+        swap(version_, other.version_);
+        swap(aliased_, other.aliased_);
+        swap(memo_, other.memo_);
+        swap(preview_, other.preview_);
+    }
+    // Takes over loaded's state; the version keeps counting up.
+    void replaceWith(StudyPlanner&& loaded) {
+        std::uint64_t version = version_;
+        *this = std::move(loaded);
+        version_ = version + 1;
+    }
+    // Writes the lazily rescaled hours of an incremental plan back to the subjects.
+    void materialize() const {
+        if (!live_.pending) return;
+        for (std::size_t i = 0; i < subjects_.size(); ++i)
+            subjects_[i]->setAllocatedHours(live_.hoursFor(live_.weights[i]));
+        live_.pending = false;
+    }
+    void endLivePlan() const {
+        materialize();
+        live_.valid = false;
+    }
+    // Brings the plan up to date after subject i's weight changed.
+    double replanSubject(std::size_t i) {
+        if (mode_ == AllocationMode::Deadline) {
+            replan();
+        } else if (live_.update(i, subjects_[i]->priorityWeight())) {
+            subjects_[i]->setAllocatedHours(live_.hoursFor(live_.weights[i]));
+        } else {
+            std::vector<double> weights(subjects_.size());
+            for (std::size_t k = 0; k < subjects_.size(); ++k) weights[k] = subjects_[k]->priorityWeight();
+            replan();
+            live_.weights = std::move(weights);
+            live_.reset(totalDailyHours_);
+        }
+        return subjects_[i]->allocatedHours();
+    }
+    // Turns weights (in subject order) into hours under the allocation mode.
+    void allocate(std::vector<double>& weights, double totalHours) const {
+        if (mode_ == AllocationMode::Deadline) {
+            for (std::size_t i = 0; i < subjects_.size(); ++i)
+                weights[i] = deadlineUrgency(weights[i], subjects_[i]->dueDay(), currentDay_);
+            deadlineAllocate(weights.data(), weights.size(), totalHours);
+        } else {
+            proportionalAllocate(weights.data(), weights.size(), totalHours);
+        }
+    }
+    static void reject(BulkReport& report, std::size_t index, std::string message) {
+        ++report.rejected;
+        if (report.errors.size() < kMaxBulkErrors) report.errors.push_back({index, std::move(message)});
+    }
+    void reindexFrom(std::size_t pos) {
+        for (std::size_t i = pos; i < subjects_.size(); ++i) index_.find(subjects_[i]->nameView())->second = i;
+    }
+    // A moved-from planner gets a fresh arena (and an index over it) on first use.
+    void ensureArena() {
+        if (arena_) return;
+        arena_ = std::make_shared<SubjectArena>();
+        index_ = SubjectIndex(0, NameHash{}, std::equal_to<>{}, SubjectIndex::allocator_type(arena_));
+    }
+    std::shared_ptr<Subject> makeSubject(Subject&& s) {
+        ensureArena();
+        return std::allocate_shared<Subject>(ArenaAllocator<Subject>(arena_), std::move(s));
+    }
+    // Appends a subject whose name is not yet indexed; false if it is a duplicate.
+    bool adopt(std::shared_ptr<Subject> sub) {
+        ensureArena();
+        const std::string_view key = sub->nameView();
+        if (!index_.emplace(key, subjects_.size()).second) return false;
+        try {
+            subjects_.push_back(std::move(sub));
+        } catch (...) {
+            index_.erase(key);
+            throw;
+        }
+        return true;
+    }
+public:
+    StudyPlanner()
+        : arena_(std::make_shared<SubjectArena>()),
+          index_(0, NameHash{}, std::equal_to<>{}, SubjectIndex::allocator_type(arena_)),
+          totalDailyHours_(4.0) {}
+    // Copies share the Subject objects (as before) but get their own arena and index.
+    StudyPlanner(const StudyPlanner& other) : StudyPlanner() { *this = other; }
+    StudyPlanner& operator=(const StudyPlanner& other) {
+        if (this == &other) return *this;
+        other.materialize();
+        StudyPlanner copy;
+        copy.totalDailyHours_ = other.totalDailyHours_;
+        copy.mode_ = other.mode_;
+        copy.currentDay_ = other.currentDay_;
+        copy.subjects_ = other.subjects_;
+        copy.layout_ = other.layout_;
+        copy.index_.reserve(copy.subjects_.size());
+        for (std::size_t i = 0; i < copy.subjects_.size(); ++i) copy.index_.emplace(copy.subjects_[i]->nameView(), i);
+        other.aliased_ = true;
+        copy.aliased_ = true;
+        replaceWith(std::move(copy));
+        return *this;
+    }
+    // Moves take the arena along and never allocate; other is left an empty
+    // planner that gets a new arena when it is next given a subject.
+    StudyPlanner(StudyPlanner&& other) noexcept
+        : arena_(std::move(other.arena_)), subjects_(std::move(other.subjects_)), index_(std::move(other.index_)),
+          totalDailyHours_(other.totalDailyHours_), mode_(other.mode_), currentDay_(other.currentDay_),
+          live_(std::exchange(other.live_, {})), layout_(std::move(other.layout_)), version_(other.version_),
+          aliased_(std::exchange(other.aliased_, false)), memo_(std::exchange(other.memo_, {})),
+          preview_(std::exchange(other.preview_, {})) {
+        other.subjects_.clear();
+        other.index_.clear();
+    }
+    StudyPlanner& operator=(StudyPlanner&& other) noexcept {
+        if (this == &other) return *this;
+        StudyPlanner taken(std::move(other));
+        swapState(taken);
+        return *this;
+    }
+    void addSubject(const std::string& name, int diff, int imp, double perf = 100.0) {
+        if (index_.find(name) != index_.end()) throw std::runtime_error("Subject already exists: " + name);
+        requireScore(name, perf);
+        endLivePlan();
+        touch();
+        layout_.reset();
+        adopt(makeSubject(Subject(name, diff, imp, perf)));
+    }
+    void removeSubject(std::string_view name) {
+        auto it = index_.find(name);
+        if (it == index_.end()) return;
+        endLivePlan();
+        touch();
+        layout_.reset();
+        std::size_t pos = it->second;
+        index_.erase(it);
+        subjects_.erase(subjects_.begin() + static_cast<std::ptrdiff_t>(pos));
+        reindexFrom(pos);
+    }
+    // Adds all subjects, or none when a name already exists or repeats within
+    // the span or a score is not finite; the subjects and index are grown once.
+    BulkReport addSubjects(std::span<const SubjectSpec> specs) {
+        BulkReport report;
+        std::unordered_map<std::string_view, std::size_t, NameHash, std::equal_to<>> seen;
+        seen.reserve(specs.size());
+        for (std::size_t i = 0; i < specs.size(); ++i) {
+            const std::string_view name = specs[i].name;
+            if (index_.find(name) != index_.end()) reject(report, i, "Subject already exists: " + std::string(name));
+            else if (!seen.emplace(name, i).second) reject(report, i, "Duplicate subject in batch: " + std::string(name));
+            else if (!std::isfinite(specs[i].perfScore)) reject(report, i, "Invalid score for " + std::string(name));
+        }
+        if (!report.ok() || specs.empty()) return report;
+        std::vector<std::shared_ptr<Subject>> made;
+        made.reserve(specs.size());
+        for (const auto& spec : specs)
+            made.push_back(makeSubject(Subject(spec.name, spec.difficulty, spec.importance, spec.perfScore)));
+        const std::size_t first = subjects_.size();
+        subjects_.reserve(first + made.size());
+        index_.reserve(first + made.size());
+        endLivePlan();
+        touch();
+        layout_.reset();
+        try {
+            for (auto& sub : made) adopt(std::move(sub));
+        } catch (...) {
+            for (std::size_t i = first; i < subjects_.size(); ++i) index_.erase(subjects_[i]->nameView());
+            subjects_.resize(first);
+            throw;
+        }
+        report.applied = made.size();
+        return report;
+    }
+    // Removes all named subjects in one compaction pass over the rest, or none
+    // when a name is unknown or repeats (unlike removeSubject, which ignores
+    // unknown names).
+    BulkReport removeSubjects(std::span<const std::string_view> names) {
+        BulkReport report;
+        std::vector<std::pair<std::size_t, std::size_t>> positions;  // (subject, name)
+        positions.reserve(names.size());
+        for (std::size_t i = 0; i < names.size(); ++i) {
+            auto it = index_.find(names[i]);
+            if (it == index_.end()) reject(report, i, "Subject not found: " + std::string(names[i]));
+            else positions.emplace_back(it->second, i);
+        }
+        std::sort(positions.begin(), positions.end());
+        for (std::size_t k = 1; k < positions.size(); ++k)
+            if (positions[k].first == positions[k - 1].first)
+                reject(report, positions[k].second, "Duplicate subject in batch: " + std::string(names[positions[k].second]));
+        if (!report.ok() || positions.empty()) return report;
+        endLivePlan();
+        touch();
+        layout_.reset();
+        std::size_t out = positions.front().first;
+        for (std::size_t i = out, k = 0; i < subjects_.size(); ++i) {
+            if (k < positions.size() && positions[k].first == i) {
+                index_.erase(subjects_[i]->nameView());
+                ++k;
+            } else {
+                subjects_[out++] = std::move(subjects_[i]);
+            }
+        }
+        subjects_.resize(out);
+        reindexFrom(positions.front().first);
+        report.applied = positions.size();
+        return report;
+    }
+    // Applies every score, or none when a subject is unknown or a score is not
+    // finite. Each subject's scores are applied in span order. The updates are
+    // grouped by subject so each is looked up once and touched in planner
+    // order. With replan the plan is kept current as in recordAndReplan.
+    BulkReport recordPerformanceBatch(std::span<const ScoreUpdate> updates, bool replan = false) {
+        SSP_METRIC_SCOPE(RecordPerformance, updates.size());
+        BulkReport report;
+        std::vector<std::pair<std::size_t, std::size_t>> order;  // (subject, update)
+        order.reserve(updates.size());
+        for (std::size_t i = 0; i < updates.size(); ++i) {
+            auto it = index_.find(updates[i].name);
+            if (it == index_.end()) reject(report, i, "Subject not found: " + std::string(updates[i].name));
+            else if (!std::isfinite(updates[i].score)) reject(report, i, "Invalid score for " + std::string(updates[i].name));
+            else order.emplace_back(it->second, i);
+        }
+        if (!report.ok() || order.empty()) return report;
+        std::sort(order.begin(), order.end());
+        const bool incremental = replan && mode_ != AllocationMode::Deadline;
+        if (!incremental) endLivePlan();
+        touch();
+        for (std::size_t k = 0; k < order.size();) {
+            const std::size_t i = order[k].first;
+            Subject& s = *subjects_[i];
+            for (; k < order.size() && order[k].first == i; ++k) s.updatePerformance(updates[order[k].second].score);
+            if (incremental) replanSubject(i);
+        }
+        if (replan && !incremental) this->replan();
+        report.applied = order.size();
+        return report;
+    }
+    std::shared_ptr<Subject> findSubject(std::string_view name) const {
+        auto it = index_.find(name);
+        if (it == index_.end()) return nullptr;
+        materialize();
+        aliased_ = true;
+        return subjects_[it->second];
+    }
+    // Read-only view of a subject, or null; unlike findSubject it shares
+    // nothing. Valid until the planner next changes.
+    const Subject* subject(std::string_view name) const {
+        auto it = index_.find(name);
+        if (it == index_.end()) return nullptr;
+        materialize();
+        return subjects_[it->second].get();
+    }
+    void setTotalDailyHours(double hrs) {
+        requireHours(hrs);
+        endLivePlan();
+        touch();
+        totalDailyHours_ = hrs;
+    }
+    double getTotalDailyHours() const { return totalDailyHours_; }
+    void setAllocationMode(AllocationMode mode) {
+        endLivePlan();
+        touch();
+        mode_ = mode;
+    }
+    AllocationMode allocationMode() const { return mode_; }
+    void setCurrentDay(int day) {
+        if (day < 0) throw std::runtime_error("Day must be non-negative");
+        endLivePlan();
+        touch();
+        currentDay_ = day;
+    }
+    int currentDay() const { return currentDay_; }
+    void setDueDay(std::string_view name, int day) {
+        auto it = index_.find(name);
+        if (it == index_.end()) throw std::runtime_error("Subject not found: " + std::string(name));
+        endLivePlan();
+        touch();
+        subjects_[it->second]->setDueDay(day);
+    }
+    std::size_t subjectCount() const { return subjects_.size(); }
+    // Full replan with weights from Policy, onto the subjects without building
+    // a Schedule, using the caller's scratch buffer; returns the hours
+    // allocated. Policy::weight inlines into a scalar loop over the subject
+    // pointers: gathering columns for the SIMD kernels (computeWeightsWith, as
+    // SubjectStore does) measured 10-25% slower here, the pointer chase
+    // dominating. The allocation pass itself still uses the kernels.
+    template <WeightingPolicy Policy = DefaultWeighting>
+    double replan(std::vector<double>& scratch) {
+        SSP_METRIC_SCOPE(Replan, subjects_.size());
+        live_ = LivePlan{};
+        touch();
+        scratch.resize(subjects_.size());
+        for (std::size_t i = 0; i < subjects_.size(); ++i) {
+            const Subject& s = *subjects_[i];
+            scratch[i] = Policy::weight(s.difficulty(), s.importance(), s.perfScore());
+        }
+        allocate(scratch, totalDailyHours_);
+        double total = 0.0;
+        for (std::size_t i = 0; i < subjects_.size(); ++i) {
+            subjects_[i]->setAllocatedHours(scratch[i]);
+            total += subjects_[i]->allocatedHours();
+        }
+        return total;
+    }
+    template <WeightingPolicy Policy = DefaultWeighting>
+    double replan() {
+        thread_local std::vector<double> scratch;
+        return replan<Policy>(scratch);
+    }
+    // Replans and returns the schedule, reusing the last one while nothing it
+    // depends on has changed (see cachedSchedule).
+    Schedule generateSchedule() {
+        SSP_METRIC_SCOPE(GenerateSchedule, subjects_.size());
+        return *cachedSchedule();
+    }
+    // generateSchedule without the copy. The memo is reused while version()
+    // is unchanged (or, once subjects are aliased, while scheduleKey() is);
+    // within that, and through ScheduleCache::shared() when it has a capacity,
+    // the plan is reused whenever the content key matches, and the subjects
+    // just get the cached hours.
+    std::shared_ptr<const Schedule> cachedSchedule() {
+        const bool shared = aliased();
+        if (memo_.valid && memo_.version == version_ && !shared) return memo_.entry.schedule;
+        const ScheduleKey key = scheduleKey();
+        std::optional<ScheduleCache::Entry> hit;
+        if (memo_.valid && memo_.key == key) hit = memo_.entry;
+        else hit = ScheduleCache::shared().find(key);
+        if (hit) {
+            endLivePlan();
+            touch();
+            const std::vector<double>& hours = *hit->hours;
+            for (std::size_t i = 0; i < subjects_.size(); ++i) subjects_[i]->setAllocatedHours(hours[i]);
+        } else {
+            replan();
+            auto hours = std::make_shared<std::vector<double>>(subjects_.size());
+            for (std::size_t i = 0; i < subjects_.size(); ++i) (*hours)[i] = subjects_[i]->allocatedHours();
+            hit = ScheduleCache::Entry{std::make_shared<const Schedule>(showCurrentSchedule()), std::move(hours)};
+            ScheduleCache::shared().insert(key, *hit);
+        }
+        memo_ = ScheduleMemo{true, version_, key, std::move(*hit)};
+        return memo_.entry.schedule;
+    }
+    // Changes with every mutation made through this planner, and once
+    // subjects that were shared are no longer (they may have been changed).
+    std::uint64_t version() const {
+        aliased();
+        return version_;
+    }
+    // True while a copy or a findSubject caller still holds one of this
+    // planner's subjects. Checking is O(1) unless subjects were handed out;
+    // then it scans the use counts until one is shared, and the first check
+    // that finds none bumps the version.
+    bool aliased() const {
+        if (aliased_ && std::all_of(subjects_.begin(), subjects_.end(), [](const auto& s) { return s.use_count() == 1; })) {
+            aliased_ = false;
+            ++version_;
+        }
+        return aliased_;
+    }
+    ScheduleKey scheduleKey() const {
+        ScheduleKeyBuilder k;
+        k.add(totalDailyHours_);
+        k.add(static_cast<std::uint64_t>(mode_));
+        k.add(static_cast<std::uint64_t>(static_cast<std::uint32_t>(currentDay_)));
+        k.add(static_cast<std::uint64_t>(subjects_.size()));
+        for (const auto& s : subjects_) {
+            k.add(static_cast<std::uint64_t>(s->nameId()));
+            k.add(static_cast<std::uint64_t>(s->difficulty()) << 32 | static_cast<std::uint32_t>(s->importance()));
+            k.add(s->perfScore());
+            k.add(static_cast<std::uint64_t>(static_cast<std::uint32_t>(s->dueDay())));
+        }
+        return k.key();
+    }
+    template <WeightingPolicy Policy>
+    Schedule generateSchedule() {
+        SSP_METRIC_SCOPE(GenerateSchedule, subjects_.size());
+        replan<Policy>();
+        return showCurrentSchedule();
+    }
+    // generateSchedule without side effects: the plan for totalDailyHours,
+    // leaving the subjects (which copies of this planner share) untouched.
+    FlatSchedule previewSchedule() const { return previewSchedule(totalDailyHours_); }
+    FlatSchedule previewSchedule(double totalDailyHours) const {
+        requireHours(totalDailyHours);
+        std::vector<double> hours(subjects_.size());
+        for (std::size_t i = 0; i < subjects_.size(); ++i) hours[i] = subjects_[i]->priorityWeight();
+        allocate(hours, totalDailyHours);
+        return FlatSchedule(layout(), std::move(hours));
+    }
+    // Starting point for what-if previews; later changes to the planner do not
+    // affect it. The sorted base is built once per version() (checked against
+    // scheduleKey() once aliased, as for cachedSchedule), so repeated queries
+    // on an unchanged planner cost O(changes) rather than O(n log n).
+    PlanPreview whatIf() const {
+        const bool shared = aliased();
+        if (!preview_.base || preview_.version != version_ || (shared && preview_.key != scheduleKey())) {
+            preview_ = PreviewMemo{version_, scheduleKey(), PlanPreview::makeBase(toStore(), layout(), mode_, currentDay_)};
+        }
+        return PlanPreview(preview_.base, totalDailyHours_);
+    }
+    double adaptiveAdjust(std::vector<double>& scratch, const AdjustParams& params) {
+        SSP_METRIC_SCOPE(AdaptiveAdjust, subjects_.size());
+        endLivePlan();
+        touch();
+        scratch.resize(2 * subjects_.size());
+        double* perf = scratch.data();
+        double* hours = perf + subjects_.size();
+        for (std::size_t i = 0; i < subjects_.size(); ++i) {
+            perf[i] = subjects_[i]->perfScore();
+            hours[i] = subjects_[i]->allocatedHours();
+        }
+        adaptiveRescale(perf, hours, subjects_.size(), totalDailyHours_, params.lowThreshold,
+                        params.highThreshold, params.boostFactor, params.reduceFactor);
+        double total = 0.0;
+        for (std::size_t i = 0; i < subjects_.size(); ++i) {
+            subjects_[i]->setAllocatedHours(hours[i]);
+            total += subjects_[i]->allocatedHours();
+        }
+        return total;
+    }
+    void adaptiveAdjust(double lowThreshold = 70.0, double highThreshold = 90.0,
+                        double boostFactor = 1.15, double reduceFactor = 0.9) {
+        thread_local std::vector<double> scratch;
+        adaptiveAdjust(scratch, {lowThreshold, highThreshold, boostFactor, reduceFactor});
+    }
+    void recordPerformance(std::string_view name, double score) {
+        SSP_METRIC_SCOPE(RecordPerformance, 1);
+        auto it = index_.find(name);
+        if (it == index_.end()) throw std::runtime_error("Subject not found: " + std::string(name));
+        requireScore(name, score);
+        endLivePlan();
+        touch();
+        subjects_[it->second]->updatePerformance(score);
+    }
+    // Records a score and keeps the plan current: like recordPerformance followed
+    // by replan(), but only the changed subject is recomputed. The other subjects'
+    // rescaled hours are written back when the plan is next read. Returns the
+    // subject's new hours.
+    double recordAndReplan(std::string_view name, double score) {
+        SSP_METRIC_SCOPE(RecordPerformance, 1);
+        auto it = index_.find(name);
+        if (it == index_.end()) throw std::runtime_error("Subject not found: " + std::string(name));
+        requireScore(name, score);
+        touch();
+        subjects_[it->second]->updatePerformance(score);
+        return replanSubject(it->second);
+    }
+    // Applies several scores (oldest first) to one subject with a single lookup.
+    // With replan the plan is kept current as in recordAndReplan; returns the
+    // subject's hours.
+    double recordPerformances(std::string_view name, std::span<const double> scores, bool replan) {
+        SSP_METRIC_SCOPE(RecordPerformance, 1);
+        auto it = index_.find(name);
+        if (it == index_.end()) throw std::runtime_error("Subject not found: " + std::string(name));
+        for (double score : scores) requireScore(name, score);
+        if (!replan) endLivePlan();
+        touch();
+        Subject& s = *subjects_[it->second];
+        for (double score : scores) s.updatePerformance(score);
+        return replan ? replanSubject(it->second) : s.allocatedHours();
+    }
+    // Hours of one subject under the current plan, without materializing the rest.
+    double plannedHours(std::string_view name) const {
+        auto it = index_.find(name);
+        if (it == index_.end()) throw std::runtime_error("Subject not found: " + std::string(name));
+        return live_.pending ? live_.hoursFor(live_.weights[it->second]) : subjects_[it->second]->allocatedHours();
+    }
+    // Replaces the file atomically (temp file, fsync, rename).
+    void saveToFile(const std::string& filename) const {
+        writeSubjectFile(filename, toStore());
+    }
+    // Queues the save on writer, which formats and writes it on its thread;
+    // the future reports completion or the write error, and dropping it does
+    // not wait. The subjects are copied into a flat SubjectStore here, on the
+    // caller's thread: an O(n) column copy (no formatting), since subjects are
+    // mutated in place and cannot be shared copy-on-write.
+    std::future<void> saveToFileAsync(const std::string& filename,
+                                      AsyncFileWriter& writer = AsyncFileWriter::shared()) const {
+        return writer.save(filename, toStore());
+    }
+    void loadFromFile(const std::string& filename) {
+        SSP_METRIC_SCOPE(LoadFile, 0);
+        std::ifstream ifs(filename);
+        if (!ifs) throw std::runtime_error("Unable to open file for reading: " + filename);
+        std::string line;
+        StudyPlanner loaded;
+        loaded.totalDailyHours_ = totalDailyHours_;
+        loaded.mode_ = mode_;
+        loaded.currentDay_ = currentDay_;
+        bool first = true;
+        while (std::getline(ifs, line)) {
+            if (line.empty()) continue;
+            if (first && line.find("name,difficulty,importance") != std::string::npos) { first = false; continue; }
+            first = false;
+            auto sub = loaded.makeSubject(Subject::fromCSV(line));
+            if (!loaded.adopt(sub)) throw std::runtime_error("Duplicate subject in file: " + sub->name());
+        }
+        SSP_METRIC_TOUCH(loaded.subjects_.size());
+        replaceWith(std::move(loaded));
+    }
+    // Replaces the subjects with the valid rows of a CSV file; malformed and
+    // duplicate rows are skipped and listed in the report.
+    CsvImportReport importCSV(const std::string& filename) {
+        SSP_METRIC_SCOPE(LoadFile, 0);
+        StudyPlanner loaded;
+        loaded.totalDailyHours_ = totalDailyHours_;
+        loaded.mode_ = mode_;
+        loaded.currentDay_ = currentDay_;
+        CsvImportReport report = readSubjectCSV(filename, [&](const CsvSubjectRow& row) -> const char* {
+            if (loaded.index_.find(row.name) != loaded.index_.end()) return "duplicate subject";
+            Subject sub(row.name, row.difficulty, row.importance, row.perfScore);
+            sub.setAllocatedHours(row.allocatedHours);
+            sub.setDueDay(row.dueDay);
+            loaded.adopt(loaded.makeSubject(std::move(sub)));
+            return nullptr;
+        });
+        SSP_METRIC_TOUCH(loaded.subjects_.size());
+        replaceWith(std::move(loaded));
+        return report;
+    }
+    void saveSnapshot(const std::string& filename) const {
+        writeSnapshot(filename, toStore(), totalDailyHours_, currentDay_, mode_);
+    }
+    // Returns the journal LSN recorded in the snapshot.
+    std::uint64_t loadSnapshot(const std::string& filename) { return loadSnapshot(SnapshotView(filename)); }
+    std::uint64_t loadSnapshot(const SnapshotView& view) {
+        SSP_METRIC_SCOPE(LoadFile, view.size());
+        StudyPlanner loaded;
+        loaded.setTotalDailyHours(view.totalDailyHours());
+        if (view.version() >= 2) {
+            loaded.mode_ = view.allocationMode();
+            loaded.currentDay_ = view.currentDay();
+        } else {
+            loaded.mode_ = mode_;
+            loaded.currentDay_ = currentDay_;
+        }
+        loaded.subjects_.reserve(view.size());
+        loaded.index_.reserve(view.size());
+        for (std::size_t i = 0; i < view.size(); ++i) {
+            auto sub = loaded.makeSubject(view.subjectAt(i));
+            if (!loaded.adopt(sub)) throw std::runtime_error("Duplicate subject in snapshot: " + sub->name());
+        }
+        replaceWith(std::move(loaded));
+        return view.journalLsn();
+    }
+    void showSubjects() const {
+        materialize();
+        if (subjects_.empty()) { std::cout << "(No subjects available)\n"; return; }
+        thread_local std::string out;
+        out.assign("Subjects:\n");
+        for (const auto& s : subjects_) {
+            out += "  ";
+            s->appendSummary(out);
+            out += '\n';
+        }
+        std::cout.write(out.data(), static_cast<std::streamsize>(out.size()));
+    }
+    Schedule showCurrentSchedule() const {
+        materialize();
+        Schedule sch;
+        for (const auto& s : subjects_) sch.alloc[s->internedName()] = s->allocatedHours();
+        return sch;
+    }
+    std::shared_ptr<const ScheduleLayout> layout() const {
+        if (!layout_) {
+            std::vector<InternedName> names;
+            names.reserve(subjects_.size());
+            for (const auto& s : subjects_) names.push_back(s->internedName());
+            layout_ = std::make_shared<const ScheduleLayout>(std::move(names));
+        }
+        return layout_;
+    }
+    FlatSchedule currentFlatSchedule() const {
+        materialize();
+        std::vector<double> hours(subjects_.size());
+        for (std::size_t i = 0; i < subjects_.size(); ++i) hours[i] = subjects_[i]->allocatedHours();
+        return FlatSchedule(layout(), std::move(hours));
+    }
+    FlatSchedule generateFlatSchedule() {
+        replan();
+        return currentFlatSchedule();
+    }
+    // One timetable for the given per-day capacities (hours), from the current weights.
+    HorizonPlan planHorizon(std::span<const double> dayHours) const {
+        std::vector<double> weights(subjects_.size());
+        for (std::size_t i = 0; i < subjects_.size(); ++i) weights[i] = subjects_[i]->priorityWeight();
+        return HorizonPlan(layout(), weights.data(), weights.size(), dayHours);
+    }
+    HorizonPlan planHorizon(int days) const {
+        return planHorizon(std::vector<double>(static_cast<std::size_t>(std::max(0, days)), totalDailyHours_));
+    }
+    // Calls fn(index, const Subject&) in planner order.
+    template <typename Fn>
+    void forEachSubject(Fn&& fn) const {
+        materialize();
+        for (std::size_t i = 0; i < subjects_.size(); ++i) fn(i, static_cast<const Subject&>(*subjects_[i]));
+    }
+    SubjectStore toStore() const {
+        materialize();
+        SubjectStore store;
+        store.reserve(subjects_.size());
+        for (const auto& s : subjects_) store.add(*s);
+        return store;
+    }
+    void loadFromStore(const SubjectStore& store) {
+        StudyPlanner loaded;
+        loaded.totalDailyHours_ = totalDailyHours_;
+        loaded.mode_ = mode_;
+        loaded.currentDay_ = currentDay_;
+        loaded.subjects_.reserve(store.size());
+        loaded.index_.reserve(store.size());
+        for (std::size_t i = 0; i < store.size(); ++i) {
+            auto sub = loaded.makeSubject(store.subjectAt(i));
+            if (!loaded.adopt(sub)) throw std::runtime_error("Duplicate subject in store: " + sub->name());
+        }
+        replaceWith(std::move(loaded));
+    }
+};
+// Containers of planners (students, shards) must move them when they grow, not copy.
+static_assert(std::is_nothrow_move_constructible_v<StudyPlanner> && std::is_nothrow_move_assignable_v<StudyPlanner>,
+              "StudyPlanner moves must be noexcept");
+// Fixed set of worker threads for data-parallel loops. The index range is split
+// into one contiguous block per worker; a worker claims grain-sized chunks from
+// its own block and, once that is drained, steals chunks from the others.
+class WorkStealingPool {
+private:
+    struct alignas(64) Block {
+        std::atomic<std::size_t> next{0};
+        std::size_t end = 0;
+    };
+    using Body = std::function<void(std::size_t, std::size_t, unsigned)>;
+    std::vector<std::thread> threads_;
+    std::unique_ptr<Block[]> blocks_;
+    unsigned workers_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    const Body* body_ = nullptr;
+    std::size_t grain_ = 1;
+    std::uint64_t generation_ = 0;
+    unsigned running_ = 0;
+    bool stop_ = false;
+    std::exception_ptr error_;
+    void drain(unsigned self) {
+        for (unsigned k = 0; k < workers_; ++k) {
+            Block& b = blocks_[(self + k) % workers_];
+            while (true) {
+                std::size_t first = b.next.fetch_add(grain_, std::memory_order_relaxed);
+                if (first >= b.end) break;
+                try {
+                    (*body_)(first, std::min(first + grain_, b.end), self);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (!error_) error_ = std::current_exception();
+                }
+            }
+        }
+    }
+    void workerLoop(unsigned self) {
+        std::uint64_t seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+                if (stop_) return;
+                seen = generation_;
+            }
+            drain(self);
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--running_ == 0) done_.notify_one();
+        }
+    }
+public:
+    explicit WorkStealingPool(unsigned threads = std::thread::hardware_concurrency())
+        : workers_(std::max(1u, threads)) {
+        blocks_ = std::make_unique<Block[]>(workers_);
+        for (unsigned i = 1; i < workers_; ++i) threads_.emplace_back([this, i] { workerLoop(i); });
+    }
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto& t : threads_) t.join();
+    }
+    unsigned size() const { return workers_; }
+    // Runs body(begin, end, worker) over [0, count); the calling thread acts as worker 0.
+    void parallelFor(std::size_t count, std::size_t grain, const Body& body) {
+        if (count == 0) return;
+        grain = std::max<std::size_t>(1, grain);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            body_ = &body;
+            grain_ = grain;
+            error_ = nullptr;
+            for (unsigned i = 0; i < workers_; ++i) {
+                blocks_[i].next.store(count * i / workers_, std::memory_order_relaxed);
+                blocks_[i].end = count * (i + 1) / workers_;
+            }
+            running_ = workers_ - 1;
+            ++generation_;
+        }
+        wake_.notify_all();
+        drain(0);
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [&] { return running_ == 0; });
+        body_ = nullptr;
+        if (error_) std::rethrow_exception(error_);
+    }
+};
+struct BatchOptions {
+    bool generate = true;
+    bool adjust = false;
+    AdjustParams adjustParams;
+    std::size_t grain = 64;
+};
+struct PlannerResult {
+    std::size_t subjects = 0;
+    double allocatedHours = 0.0;
+    bool ok = false;
+};
+// Regenerates (and optionally adjusts) many independent planners in parallel.
+// Each worker owns a scratch buffer, so after warm-up nothing is allocated per
+// planner; results are written into a caller-sized vector.
+class BatchScheduler {
+private:
+    WorkStealingPool pool_;
+    std::vector<std::vector<double>> scratch_;
+public:
+    explicit BatchScheduler(unsigned threads = std::thread::hardware_concurrency())
+        : pool_(threads), scratch_(pool_.size()) {}
+    unsigned threads() const { return pool_.size(); }
+    void run(StudyPlanner* planners, std::size_t count, const BatchOptions& opts,
+             std::vector<PlannerResult>& results) {
+        results.assign(count, PlannerResult{});
+        pool_.parallelFor(count, opts.grain, [&](std::size_t first, std::size_t last, unsigned worker) {
+            auto& scratch = scratch_[worker];
+            for (std::size_t i = first; i < last; ++i) {
+                PlannerResult& r = results[i];
+                r.subjects = planners[i].subjectCount();
+                if (opts.generate) r.allocatedHours = planners[i].replan(scratch);
+                if (opts.adjust) r.allocatedHours = planners[i].adaptiveAdjust(scratch, opts.adjustParams);
+                r.ok = true;
+            }
+        });
+    }
+    void run(std::vector<StudyPlanner>& planners, const BatchOptions& opts, std::vector<PlannerResult>& results) {
+        run(planners.data(), planners.size(), opts, results);
+    }
+    // Multi-tenant form: tenant t owns subjects [offsets[t], offsets[t + 1]) of the
+    // table and has dailyHours[t] to spread over them.
+    void run(SubjectStore& table, const std::vector<std::size_t>& offsets, const std::vector<double>& dailyHours,
+             const BatchOptions& opts, std::vector<PlannerResult>& results) {
+        if (offsets.empty() || offsets.size() != dailyHours.size() + 1 || offsets.back() > table.size())
+            throw std::runtime_error("Tenant offsets do not match the subject table");
+        const std::size_t tenants = dailyHours.size();
+        results.assign(tenants, PlannerResult{});
+        pool_.parallelFor(tenants, opts.grain, [&](std::size_t first, std::size_t last, unsigned) {
+            for (std::size_t t = first; t < last; ++t) {
+                PlannerResult& r = results[t];
+                if (offsets[t + 1] < offsets[t]) continue;
+                r.subjects = offsets[t + 1] - offsets[t];
+                if (opts.generate) r.allocatedHours = table.generateRange(offsets[t], r.subjects, dailyHours[t]);
+                if (opts.adjust)
+                    r.allocatedHours = table.adjustRange(offsets[t], r.subjects, dailyHours[t], opts.adjustParams);
+                r.ok = true;
+            }
+        });
+    }
+};
+// Outcome of replaying a score history under one set of adjust parameters,
+// summed over every student and round.
+struct AdjustOutcome {
+    AdjustParams params;
+    double weakShare = 0.0;    // share of hours spent on subjects below lowThreshold
+    double churn = 0.0;        // share of hours moved by each adjustment
+    double gainPerHour = 0.0;  // next round's perfScore change, weighted by hours
+};
+// Grid search over adaptiveAdjust parameters against historical scores. The
+// cohort is a multi-tenant table as in BatchScheduler::run, and scores holds
+// one row of cohort.size() scores per round (NaN where a subject got none).
+// Every run starts from a full replan and then, per round, applies the scores
+// through updatePerformance and calls adaptiveAdjust.
+// The perfScore trajectory does not depend on the parameters, so it is
+// replayed once and shared read-only; a configuration only owns its hours.
+// Students are processed in cache-sized tiles and each tile's configurations
+// are spread over the pool. The results do not depend on the thread count.
+class AdjustSimulator {
+private:
+    static constexpr std::size_t kTileBytes = std::size_t(1) << 20;
+    WorkStealingPool pool_;
+    std::vector<std::size_t> offsets_;
+    std::vector<double> dailyHours_;
+    std::size_t rounds_;
+    std::vector<double> initialHours_;
+    // Student t's perfScores after round r: trajectory_[offsets_[t] * rounds_ + r * k + j].
+    std::vector<double> trajectory_;
+    std::vector<std::vector<double>> scratch_;
+    struct Sums { double hours = 0, weak = 0, moved = 0, gain = 0, gainHours = 0; };
+    void simulate(std::size_t t, const AdjustParams& p, std::vector<double>& scratch, Sums& sums) const {
+        const std::size_t first = offsets_[t], k = offsets_[t + 1] - first;
+        scratch.resize(2 * k);
+        double* hours = scratch.data();
+        double* before = hours + k;
+        std::copy_n(initialHours_.data() + first, k, hours);
+        const double* perf = trajectory_.data() + first * rounds_;
+        for (std::size_t r = 0; r < rounds_; ++r, perf += k) {
+            std::copy_n(hours, k, before);
+            adaptiveRescale(perf, hours, k, dailyHours_[t], p.lowThreshold, p.highThreshold, p.boostFactor,
+                            p.reduceFactor);
+            for (std::size_t j = 0; j < k; ++j) {
+                sums.hours += hours[j];
+                sums.moved += std::abs(hours[j] - before[j]);
+                if (perf[j] < p.lowThreshold) sums.weak += hours[j];
+                if (r + 1 < rounds_) {
+                    sums.gain += hours[j] * (perf[k + j] - perf[j]);
+                    sums.gainHours += hours[j];
+                }
+            }
+        }
+    }
+public:
+    AdjustSimulator(const SubjectStore& cohort, std::vector<std::size_t> offsets, std::vector<double> dailyHours,
+                    std::span<const double> scores, std::size_t rounds,
+                    unsigned threads = std::thread::hardware_concurrency())
+        : pool_(threads), offsets_(std::move(offsets)), dailyHours_(std::move(dailyHours)), rounds_(rounds),
+          scratch_(pool_.size()) {
+        if (offsets_.empty() || offsets_.size() != dailyHours_.size() + 1 || offsets_.back() != cohort.size())
+            throw std::runtime_error("Tenant offsets do not match the subject table");
+        for (std::size_t t = 0; t + 1 < offsets_.size(); ++t)
+            if (offsets_[t + 1] < offsets_[t]) throw std::runtime_error("Tenant offsets do not match the subject table");
+        if (scores.size() != rounds * cohort.size()) throw std::runtime_error("Score history must hold one row per round");
+        const std::size_t n = cohort.size();
+        SubjectStore base = cohort;
+        initialHours_.resize(n);
+        trajectory_.resize(n * rounds);
+        pool_.parallelFor(students(), 64, [&](std::size_t firstStudent, std::size_t lastStudent, unsigned) {
+            for (std::size_t t = firstStudent; t < lastStudent; ++t) {
+                const std::size_t first = offsets_[t], k = offsets_[t + 1] - first;
+                base.generateRange(first, k, dailyHours_[t]);
+                std::copy_n(base.allocatedHours() + first, k, initialHours_.data() + first);
+                double* out = trajectory_.data() + first * rounds_;
+                for (std::size_t r = 0; r < rounds_; ++r, out += k)
+                    for (std::size_t j = 0; j < k; ++j) {
+                        double s = scores[r * n + first + j];
+                        if (!std::isnan(s)) base[first + j].updatePerformance(s);
+                        out[j] = base.perfScores()[first + j];
+                    }
+            }
+        });
+    }
+    std::size_t students() const { return dailyHours_.size(); }
+    std::size_t rounds() const { return rounds_; }
+    std::vector<AdjustOutcome> run(std::span<const AdjustParams> configs) {
+        std::vector<Sums> sums(configs.size());
+        const std::size_t grain = std::max<std::size_t>(1, configs.size() / (8 * pool_.size()));
+        const std::size_t tileSubjects = std::max<std::size_t>(1, kTileBytes / (sizeof(double) * std::max<std::size_t>(rounds_, 1)));
+        for (std::size_t tileBegin = 0; tileBegin < students();) {
+            std::size_t tileEnd = tileBegin + 1;
+            while (tileEnd < students() && offsets_[tileEnd + 1] - offsets_[tileBegin] <= tileSubjects) ++tileEnd;
+            pool_.parallelFor(configs.size(), grain, [&](std::size_t first, std::size_t last, unsigned worker) {
+                for (std::size_t c = first; c < last; ++c)
+                    for (std::size_t t = tileBegin; t < tileEnd; ++t) simulate(t, configs[c], scratch_[worker], sums[c]);
+            });
+            tileBegin = tileEnd;
+        }
+        std::vector<AdjustOutcome> out(configs.size());
+        auto ratio = [](double a, double b) { return b > 0 ? a / b : 0.0; };
+        for (std::size_t c = 0; c < configs.size(); ++c)
+            out[c] = {configs[c], ratio(sums[c].weak, sums[c].hours), ratio(sums[c].moved, sums[c].hours),
+                      ratio(sums[c].gain, sums[c].gainHours)};
+        return out;
+    }
+    // Every combination of the given values, low thresholds varying slowest.
+    static std::vector<AdjustParams> grid(std::span<const double> low, std::span<const double> high,
+                                          std::span<const double> boost, std::span<const double> reduce) {
+        std::vector<AdjustParams> out;
+        out.reserve(low.size() * high.size() * boost.size() * reduce.size());
+        for (double l : low)
+            for (double h : high)
+                for (double b : boost)
+                    for (double r : reduce) out.push_back({l, h, b, r});
+        return out;
+    }
+};
+// Planner whose mutations are journaled. The durable state is the snapshot
+// <base>.snap plus the journal records after the snapshot's LSN in <base>.wal
+// (and <base>.wal.old while a compaction is running). Each change appends one
+// record; compaction writes a new snapshot on a background thread and then
+// drops the log it folded in. Reads go through planner().
+class DurablePlanner {
+private:
+    std::string snapPath_, walPath_, oldWalPath_;
+    JournalOptions options_;
+    StudyPlanner planner_;
+    std::unique_ptr<PlannerJournal> journal_;
+    std::thread compactor_;
+    std::exception_ptr compactError_;
+    std::uint64_t sinceCompaction_ = 0;
+    void apply(const JournalRecord& rec) {
+        switch (rec.op) {
+            case JournalOp::AddSubject: planner_.addSubject(rec.name, rec.difficulty, rec.importance, rec.value); break;
+            case JournalOp::RemoveSubject: planner_.removeSubject(rec.name); break;
+            case JournalOp::RecordPerformance: planner_.recordPerformance(rec.name, rec.value); break;
+            case JournalOp::SetTotalDailyHours: planner_.setTotalDailyHours(rec.value); break;
+        }
+    }
+    // Called after the change has been applied, so only successful changes are logged.
+    void logged(const JournalRecord& rec) {
+        journal_->append(rec);
+        if (++sinceCompaction_ >= options_.compactAfterRecords) compact();
+    }
+    void writeSnapshotFile(const SubjectStore& store, double hours, int day, AllocationMode mode,
+                           std::uint64_t lsn) const {
+        const std::string tmp = snapPath_ + ".tmp";
+        writeSnapshot(tmp, store, hours, day, mode, lsn);
+        syncFile(tmp);
+        replaceFile(tmp, snapPath_);
+    }
+public:
+    explicit DurablePlanner(const std::string& basePath, const JournalOptions& options = {})
+        : snapPath_(basePath + ".snap"), walPath_(basePath + ".wal"), oldWalPath_(basePath + ".wal.old"),
+          options_(options) {
+        std::uint64_t lsn = std::filesystem::exists(snapPath_) ? planner_.loadSnapshot(snapPath_) : 0;
+        const std::uint64_t snapLsn = lsn;
+        auto replayInto = [&](const std::string& path) {
+            lsn = std::max(lsn, PlannerJournal::replay(path, snapLsn, [&](const JournalRecord& rec) { apply(rec); }));
+        };
+        const bool interrupted = std::filesystem::exists(oldWalPath_);
+        if (interrupted) replayInto(oldWalPath_);
+        replayInto(walPath_);
+        if (interrupted) {
+            // A compaction did not finish: fold both logs in before appending again.
+            writeSnapshotFile(planner_.toStore(), planner_.getTotalDailyHours(), planner_.currentDay(),
+                              planner_.allocationMode(), lsn);
+            std::filesystem::remove(oldWalPath_);
+            if (std::filesystem::exists(walPath_)) std::filesystem::resize_file(walPath_, 0);
+        }
+        journal_ = std::make_unique<PlannerJournal>(walPath_, lsn + 1, options_);
+    }
+    DurablePlanner(const DurablePlanner&) = delete;
+    DurablePlanner& operator=(const DurablePlanner&) = delete;
+    ~DurablePlanner() {
+        if (compactor_.joinable()) compactor_.join();
+    }
+    const StudyPlanner& planner() const { return planner_; }
+    std::uint64_t lastLsn() const { return journal_->lastLsn(); }
+    std::uint64_t durableLsn() const { return journal_->durableLsn(); }
+    void addSubject(const std::string& name, int diff, int imp, double perf = 100.0) {
+        PlannerJournal::checkName(name);
+        planner_.addSubject(name, diff, imp, perf);
+        const Subject& s = *planner_.subject(name);
+        logged({0, JournalOp::AddSubject, name, s.difficulty(), s.importance(), s.perfScore()});
+    }
+    void removeSubject(const std::string& name) {
+        planner_.removeSubject(name);
+        logged({0, JournalOp::RemoveSubject, name});
+    }
+    void recordPerformance(const std::string& name, double score) {
+        planner_.recordPerformance(name, score);
+        logged({0, JournalOp::RecordPerformance, name, 0, 0, score});
+    }
+    double recordAndReplan(const std::string& name, double score) {
+        double hours = planner_.recordAndReplan(name, score);
+        logged({0, JournalOp::RecordPerformance, name, 0, 0, score});
+        return hours;
+    }
+    void setTotalDailyHours(double hrs) {
+        planner_.setTotalDailyHours(hrs);
+        logged({0, JournalOp::SetTotalDailyHours, {}, 0, 0, hrs});
+    }
+    // Allocated hours are derived state and are not journaled.
+    Schedule generateSchedule() { return planner_.generateSchedule(); }
+    void sync() { journal_->sync(); }
+    // Starts folding everything logged so far into the snapshot. The live log is
+    // rotated to .wal.old here; the snapshot is written from a copy of the
+    // subjects on a background thread, which then deletes .wal.old.
+    void compact() {
+        waitForCompaction();
+        journal_->sync();
+        const std::uint64_t lsn = journal_->lastLsn();
+        journal_.reset();
+        std::filesystem::rename(walPath_, oldWalPath_);
+        syncParentDirectory(walPath_);
+        journal_ = std::make_unique<PlannerJournal>(walPath_, lsn + 1, options_);
+        sinceCompaction_ = 0;
+        SubjectStore store = planner_.toStore();
+        compactor_ = std::thread([this, store = std::move(store), hours = planner_.getTotalDailyHours(),
+                                  day = planner_.currentDay(), mode = planner_.allocationMode(), lsn] {
+            try {
+                writeSnapshotFile(store, hours, day, mode, lsn);
+                std::filesystem::remove(oldWalPath_);
+            } catch (...) {
+                compactError_ = std::current_exception();
+            }
+        });
+    }
+    // Waits for a running compaction and rethrows its error, if any.
+    void waitForCompaction() {
+        if (compactor_.joinable()) compactor_.join();
+        if (compactError_) std::rethrow_exception(std::exchange(compactError_, nullptr));
+    }
+};
+// Immutable published state of a ConcurrentPlanner: the schedule after the last
+// batch of updates plus the scores it was computed from.
+struct PlanSnapshot {
+    using NameIndex = std::unordered_map<std::string_view, std::size_t, NameHash, std::equal_to<>>;
+    std::uint64_t epoch = 0;
+    double totalDailyHours = 0.0;
+    FlatSchedule schedule;
+    std::vector<double> perfScores;
+    std::shared_ptr<const NameIndex> index;   // into schedule's layout; shared while the layout is
+    std::size_t size() const { return schedule.size(); }
+    // Slot of the subject, or npos.
+    std::size_t find(std::string_view name) const {
+        auto it = index->find(name);
+        return it == index->end() ? static_cast<std::size_t>(-1) : it->second;
+    }
+    double hoursFor(std::string_view name) const {
+        std::size_t i = find(name);
+        if (i == static_cast<std::size_t>(-1)) throw std::runtime_error("Subject not found: " + std::string(name));
+        return schedule.hours(i);
+    }
+};
+// Shares one planner between writers and many readers. Writers take a mutex,
+// apply changes to the private planner and, once per batch, publish a new
+// PlanSnapshot; old snapshots are freed when the last reader lets go (RCU with
+// reference counts as the grace period). Snapshots are published into two
+// slots indexed by epoch parity, so readers never take a lock: a reader pins the
+// current slot, re-checks the epoch and copies the shared_ptr. A writer waits
+// only for readers still pinning the slot it is about to reuse, which held the
+// snapshot from two publishes ago. (libstdc++ 12's atomic<shared_ptr> is not
+// lock-free and its load does not order against a later store.) Reader handles
+// cache their snapshot and only reload it when the epoch moves, so a
+// steady-state read is one atomic load of a rarely written counter.
+class ConcurrentPlanner {
+private:
+    mutable std::mutex writeMutex_;
+    StudyPlanner planner_;
+    std::size_t batchSize_;
+    std::size_t pending_ = 0;
+    std::shared_ptr<const PlanSnapshot::NameIndex> index_;
+    std::shared_ptr<const ScheduleLayout> indexedLayout_;
+    struct alignas(64) Slot {
+        std::shared_ptr<const PlanSnapshot> snapshot;   // written only by publishLocked()
+        mutable std::atomic<std::uint32_t> pins{0};     // readers copying `snapshot`
+    };
+    Slot slots_[2];
+    std::atomic<std::uint64_t> epoch_{0};
+    void publishLocked() {
+        auto snap = std::make_shared<PlanSnapshot>();
+        const std::uint64_t epoch = epoch_.load(std::memory_order_relaxed) + 1;
+        snap->epoch = epoch;
+        snap->totalDailyHours = planner_.getTotalDailyHours();
+        snap->schedule = planner_.currentFlatSchedule();
+        if (indexedLayout_ != snap->schedule.layout()) {
+            auto index = std::make_shared<PlanSnapshot::NameIndex>();
+            index->reserve(snap->schedule.size());
+            for (std::size_t i = 0; i < snap->schedule.size(); ++i) index->emplace(snap->schedule.name(i), i);
+            index_ = std::move(index);
+            indexedLayout_ = snap->schedule.layout();
+        }
+        snap->index = index_;
+        snap->perfScores.resize(planner_.subjectCount());
+        planner_.forEachSubject([&](std::size_t i, const Subject& s) { snap->perfScores[i] = s.perfScore(); });
+        // A reader pinning this slot saw epoch - 2 and will fail its re-check;
+        // wait for it to let go before the slot is overwritten.
+        Slot& slot = slots_[epoch & 1];
+        while (slot.pins.load(std::memory_order_seq_cst) != 0) std::this_thread::yield();
+        std::shared_ptr<const PlanSnapshot> old = std::exchange(slot.snapshot, std::move(snap));
+        epoch_.store(epoch, std::memory_order_seq_cst);
+        pending_ = 0;
+    }
+public:
+    class Reader {
+    private:
+        const ConcurrentPlanner* owner_;
+        std::uint64_t epoch_ = 0;
+        std::shared_ptr<const PlanSnapshot> cached_;
+    public:
+        explicit Reader(const ConcurrentPlanner& owner) : owner_(&owner) {}
+        // Valid until the next call on this Reader.
+        const PlanSnapshot& snapshot() {
+            if (owner_->epoch_.load(std::memory_order_acquire) != epoch_) {
+                cached_ = owner_->snapshot();
+                epoch_ = cached_->epoch;
+            }
+            return *cached_;
+        }
+    };
+    explicit ConcurrentPlanner(StudyPlanner planner = {}, std::size_t batchSize = 256)
+        : planner_(std::move(planner)), batchSize_(std::max<std::size_t>(1, batchSize)) {
+        planner_.replan();
+        publishLocked();
+    }
+    ConcurrentPlanner(const ConcurrentPlanner&) = delete;
+    ConcurrentPlanner& operator=(const ConcurrentPlanner&) = delete;
+    Reader reader() const { return Reader(*this); }
+    std::shared_ptr<const PlanSnapshot> snapshot() const {
+        while (true) {
+            const std::uint64_t epoch = epoch_.load(std::memory_order_acquire);
+            const Slot& slot = slots_[epoch & 1];
+            slot.pins.fetch_add(1, std::memory_order_seq_cst);
+            if (epoch_.load(std::memory_order_seq_cst) == epoch) {
+                std::shared_ptr<const PlanSnapshot> snap = slot.snapshot;
+                slot.pins.fetch_sub(1, std::memory_order_release);
+                return snap;
+            }
+            slot.pins.fetch_sub(1, std::memory_order_release);
+        }
+    }
+    std::uint64_t epoch() const { return epoch_.load(std::memory_order_acquire); }
+    Schedule showCurrentSchedule() const { return snapshot()->schedule.toSchedule(); }
+    // Score updates go through the incremental replan and become visible with
+    // the batch they complete, or at the next publish().
+    void recordPerformance(std::string_view name, double score) {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        planner_.recordAndReplan(name, score);
+        if (++pending_ >= batchSize_) publishLocked();
+    }
+    // Applies fn(StudyPlanner&), replans and publishes, all as one version.
+    template <typename Fn>
+    void update(Fn&& fn) {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        fn(planner_);
+        planner_.replan();
+        publishLocked();
+    }
+    // Publishes pending score updates, if any.
+    void publish() {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        if (pending_ > 0) publishLocked();
+    }
+};
+// Bounded multi-producer / single-consumer ring (Vyukov's sequence-numbered
+// cells). tryPush never blocks and fails when the ring is full; only the one
+// consumer thread may call tryPop.
+template <typename T>
+class BoundedMpscQueue {
+private:
+    struct Cell {
+        std::atomic<std::size_t> seq;
+        T value;
+    };
+    std::unique_ptr<Cell[]> cells_;
+    std::size_t mask_;
+    alignas(64) std::atomic<std::size_t> tail_{0};
+    alignas(64) std::size_t head_ = 0;
+public:
+    explicit BoundedMpscQueue(std::size_t capacity) {
+        std::size_t n = 2;
+        while (n < capacity) n <<= 1;
+        cells_ = std::make_unique<Cell[]>(n);
+        mask_ = n - 1;
+        for (std::size_t i = 0; i < n; ++i) cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+    std::size_t capacity() const { return mask_ + 1; }
+    // Number of pushes claimed so far.
+    std::size_t pushed() const { return tail_.load(std::memory_order_acquire); }
+    bool tryPush(T&& v) {
+        std::size_t pos = tail_.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& c = cells_[pos & mask_];
+            const std::size_t seq = c.seq.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    c.value = std::move(v);
+                    c.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+    bool empty() const { return cells_[head_ & mask_].seq.load(std::memory_order_acquire) != head_ + 1; }
+    bool tryPop(T& out) {
+        Cell& c = cells_[head_ & mask_];
+        if (c.seq.load(std::memory_order_acquire) != head_ + 1) return false;
+        out = std::move(c.value);
+        c.seq.store(head_ + mask_ + 1, std::memory_order_release);
+        ++head_;
+        return true;
+    }
+};
+struct IngestOptions {
+    std::size_t capacity = 1 << 16;   // queued scores before producers are held back
+    std::size_t maxBatch = 4096;
+    bool replan = true;               // keep the plan current (incremental replan)
+};
+struct IngestBatchStats {
+    std::size_t scores = 0;
+    std::size_t subjects = 0;
+    std::size_t rejected = 0;
+    double applyMicros = 0.0;
+    double meanLatencyMicros = 0.0;   // enqueue to applied
+    double maxLatencyMicros = 0.0;
+};
+struct IngestMetrics {
+    std::uint64_t batches = 0;
+    std::uint64_t scores = 0;
+    std::uint64_t coalesced = 0;      // scores that shared a lookup with an earlier one in their batch
+    std::uint64_t rejected = 0;       // unknown subjects
+    std::uint64_t producerWaits = 0;  // pushes that found the queue full
+    double maxApplyMicros = 0.0;
+    double maxLatencyMicros = 0.0;
+    IngestBatchStats last;
+};
+// Accepts scores from any number of threads and applies them to one planner on
+// a single applier thread. Each drained batch is grouped by subject, so a
+// subject's scores (in arrival order) cost one lookup and one replan step.
+// While the ingestor runs, only the applier may touch the planner.
+class ScoreIngestor {
+private:
+    struct ScoreEvent {
+        std::string name;
+        double score = 0.0;
+        std::chrono::steady_clock::time_point enqueued;
+    };
+    StudyPlanner& planner_;
+    IngestOptions options_;
+    BoundedMpscQueue<ScoreEvent> queue_;
+    std::atomic<bool> stop_{false};
+    std::atomic<bool> applierWaiting_{false};
+    std::atomic<std::uint32_t> signal_{0};
+    std::atomic<std::uint64_t> producerWaits_{0};
+    std::atomic<std::size_t> processed_{0};
+    mutable std::mutex metricsMutex_;
+    IngestMetrics metrics_;
+    std::function<void(const IngestBatchStats&)> onBatch_;
+    std::thread applier_;
+    void wakeApplier() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (applierWaiting_.load(std::memory_order_relaxed)) {
+            signal_.fetch_add(1, std::memory_order_relaxed);
+            signal_.notify_one();
+        }
+    }
+    void run() {
+        struct Group {
+            std::string_view name;
+            std::vector<double> scores;
+        };
+        std::vector<ScoreEvent> batch;
+        std::vector<Group> groups;
+        std::unordered_map<std::string_view, std::size_t, NameHash, std::equal_to<>> groupOf;
+        batch.reserve(options_.maxBatch);
+        while (true) {
+            batch.clear();
+            ScoreEvent ev;
+            while (batch.size() < options_.maxBatch && queue_.tryPop(ev)) batch.push_back(std::move(ev));
+            if (batch.empty()) {
+                if (stop_.load(std::memory_order_acquire)) {
+                    // Nothing more will be applied; release every flush().
+                    processed_.store(std::numeric_limits<std::size_t>::max(), std::memory_order_release);
+                    processed_.notify_all();
+                    return;
+                }
+                const std::uint32_t seen = signal_.load(std::memory_order_relaxed);
+                applierWaiting_.store(true, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (queue_.empty() && !stop_.load(std::memory_order_acquire)) signal_.wait(seen);
+                applierWaiting_.store(false, std::memory_order_relaxed);
+                continue;
+            }
+            std::size_t used = 0;
+            groupOf.clear();
+            for (const auto& e : batch) {
+                auto [it, inserted] = groupOf.emplace(e.name, used);
+                if (inserted) {
+                    if (used == groups.size()) groups.emplace_back();
+                    groups[used].name = e.name;
+                    groups[used].scores.clear();
+                    ++used;
+                }
+                groups[it->second].scores.push_back(e.score);
+            }
+            IngestBatchStats stats;
+            stats.scores = batch.size();
+            stats.subjects = used;
+            const auto start = std::chrono::steady_clock::now();
+            for (std::size_t g = 0; g < used; ++g) {
+                try {
+                    planner_.recordPerformances(groups[g].name, groups[g].scores, options_.replan);
+                } catch (const std::runtime_error&) {
+                    stats.rejected += groups[g].scores.size();
+                }
+            }
+            const auto end = std::chrono::steady_clock::now();
+            stats.applyMicros = std::chrono::duration<double, std::micro>(end - start).count();
+            double latencySum = 0.0;
+            for (const auto& e : batch) {
+                double us = std::chrono::duration<double, std::micro>(end - e.enqueued).count();
+                latencySum += us;
+                stats.maxLatencyMicros = std::max(stats.maxLatencyMicros, us);
+            }
+            stats.meanLatencyMicros = latencySum / static_cast<double>(batch.size());
+            {
+                std::lock_guard<std::mutex> lock(metricsMutex_);
+                ++metrics_.batches;
+                metrics_.scores += stats.scores;
+                metrics_.coalesced += stats.scores - stats.subjects;
+                metrics_.rejected += stats.rejected;
+                metrics_.maxApplyMicros = std::max(metrics_.maxApplyMicros, stats.applyMicros);
+                metrics_.maxLatencyMicros = std::max(metrics_.maxLatencyMicros, stats.maxLatencyMicros);
+                metrics_.last = stats;
+            }
+            if (onBatch_) onBatch_(stats);
+            processed_.fetch_add(batch.size(), std::memory_order_release);
+            processed_.notify_all();
+        }
+    }
+public:
+    explicit ScoreIngestor(StudyPlanner& planner, const IngestOptions& options = {},
+                           std::function<void(const IngestBatchStats&)> onBatch = {})
+        : planner_(planner), options_(options), queue_(std::max<std::size_t>(2, options.capacity)),
+          onBatch_(std::move(onBatch)) {
+        options_.maxBatch = std::max<std::size_t>(1, options_.maxBatch);
+        applier_ = std::thread([this] { run(); });
+    }
+    ScoreIngestor(const ScoreIngestor&) = delete;
+    ScoreIngestor& operator=(const ScoreIngestor&) = delete;
+    ~ScoreIngestor() { stop(); }
+    // Queues a score unless the queue is full or stop() was called.
+    bool tryPush(std::string name, double score) {
+        if (stop_.load(std::memory_order_acquire)) return false;
+        if (!queue_.tryPush({std::move(name), score, std::chrono::steady_clock::now()})) return false;
+        wakeApplier();
+        return true;
+    }
+    // Queues a score, backing off while the queue is full. Throws once stop()
+    // was called, since nothing would drain the queue.
+    void push(std::string name, double score) {
+        auto stopped = [this] {
+            if (stop_.load(std::memory_order_acquire)) throw std::runtime_error("Score ingestor is stopped");
+        };
+        stopped();
+        ScoreEvent ev{std::move(name), score, std::chrono::steady_clock::now()};
+        if (!queue_.tryPush(std::move(ev))) {
+            producerWaits_.fetch_add(1, std::memory_order_relaxed);
+            wakeApplier();
+            for (unsigned spin = 0; !queue_.tryPush(std::move(ev)); ++spin) {
+                stopped();
+                if (spin < 64) std::this_thread::yield();
+                else std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+        wakeApplier();
+    }
+    // Waits until everything queued before the call has been applied, or the
+    // applier has stopped.
+    void flush() {
+        const std::size_t target = queue_.pushed();
+        signal_.fetch_add(1, std::memory_order_relaxed);
+        signal_.notify_one();
+        for (std::size_t done = processed_.load(std::memory_order_acquire); done < target;
+             done = processed_.load(std::memory_order_acquire))
+            processed_.wait(done);
+    }
+    // Applies what is queued and stops the applier; later pushes fail, and one
+    // racing with stop() may be left unapplied.
+    void stop() {
+        if (!applier_.joinable()) return;
+        stop_.store(true, std::memory_order_release);
+        signal_.fetch_add(1, std::memory_order_relaxed);
+        signal_.notify_one();
+        applier_.join();
+    }
+    IngestMetrics metrics() const {
+        std::lock_guard<std::mutex> lock(metricsMutex_);
+        IngestMetrics m = metrics_;
+        m.producerWaits = producerWaits_.load(std::memory_order_relaxed);
+        return m;
+    }
+};
+// Just enough of a FlatBuffers encoder for Arrow IPC metadata. Objects are
+// written front to back: each table right after its vtable, and the objects a
+// table refers to after the table, since FlatBuffers offsets point forward.
+// Scalars are copied in host order, so this assumes a little-endian host.
+class FlatBufferWriter {
+public:
+    using Child = std::function<std::size_t(FlatBufferWriter&)>;
+    struct Field {
+        int id;
+        int size = 0;            // 1, 2, 4 or 8 for a scalar; 0 for a child object
+        std::uint64_t bits = 0;
+        Child child = {};
+    };
+private:
+    std::string buf_;
+    void pad(std::size_t align) { buf_.resize((buf_.size() + align - 1) / align * align, '\0'); }
+    template <typename T>
+    void put(T v) { buf_.append(reinterpret_cast<const char*>(&v), sizeof v); }
+    void link(std::size_t at, std::size_t target) {
+        const auto rel = static_cast<std::uint32_t>(target - at);
+        std::memcpy(buf_.data() + at, &rel, sizeof rel);
+    }
 public:
-    Subject() : name_(""), difficulty_(5), importance_(5),
-                perfScore_(100.0), allocatedHours_(0.0) {}
-    Subject(const std::string& name, int difficulty, int importance, double perfScore = 100.0)
-        : name_(name),
-          difficulty_(clamp(difficulty, 1, 10)),
-          importance_(clamp(importance, 1, 10)),
-          perfScore_(clamp(perfScore, 0.0, 100.0)),
-          allocatedHours_(0.0) {}
-    std::string name() const { return name_; }
-    int difficulty() const { return difficulty_; }
-    int importance() const { return importance_; }
-    double perfScore() const { return perfScore_; }
-    double allocatedHours() const { return allocatedHours_; }
-    double priorityWeight() const {
-        double perfFactor = 1.5 - (perfScore_ / 100.0);
-        double base = static_cast<double>(difficulty_) * static_cast<double>(importance_);
-        return base * perfFactor;
+    std::size_t table(std::vector<Field> fields) {
+        auto width = [](const Field& f) { return f.size ? f.size : 4; };
+        std::stable_sort(fields.begin(), fields.end(), [&](const Field& a, const Field& b) { return width(a) > width(b); });
+        int maxId = -1;
+        for (const auto& f : fields) maxId = std::max(maxId, f.id);
+        std::vector<std::uint16_t> at(static_cast<std::size_t>(maxId + 1), 0);
+        std::size_t size = 4;
+        for (const auto& f : fields) {
+            const std::size_t w = static_cast<std::size_t>(width(f));
+            size = (size + w - 1) / w * w;
+            at[static_cast<std::size_t>(f.id)] = static_cast<std::uint16_t>(size);
+            size += w;
+        }
+        pad(2);
+        const std::size_t vtable = buf_.size();
+        put<std::uint16_t>(static_cast<std::uint16_t>(4 + 2 * at.size()));
+        put<std::uint16_t>(static_cast<std::uint16_t>(size));
+        for (std::uint16_t o : at) put(o);
+        pad(8);  // 8-byte fields sit at multiples of 8 from the table start
+        const std::size_t start = buf_.size();
+        buf_.resize(start + size, '\0');
+        const auto back = static_cast<std::int32_t>(start - vtable);
+        std::memcpy(buf_.data() + start, &back, sizeof back);
+        for (const auto& f : fields)
+            if (f.size) std::memcpy(buf_.data() + start + at[static_cast<std::size_t>(f.id)], &f.bits, static_cast<std::size_t>(f.size));
+        for (const auto& f : fields)
+            if (!f.size) link(start + at[static_cast<std::size_t>(f.id)], f.child(*this));
+        return start;
     }
-    void setAllocatedHours(double hrs) {
-        allocatedHours_ = std::max(0.0, hrs);
+    std::size_t string(std::string_view s) {
+        pad(4);
+        const std::size_t pos = buf_.size();
+        put(static_cast<std::uint32_t>(s.size()));
+        buf_.append(s);
+        buf_ += '\0';
+        return pos;
     }
-    void updatePerformance(double newScore) {
-        newScore = clamp(newScore, 0.0, 100.0);
-        historyScores_.push_back(newScore);
-        if (historyScores_.size() > 10) historyScores_.erase(historyScores_.begin());
-        double sum = std::accumulate(historyScores_.begin(), historyScores_.end(), 0.0);
-        perfScore_ = sum / historyScores_.size();
+    std::size_t tables(const std::vector<Child>& items) {
+        pad(4);
+        const std::size_t pos = buf_.size();
+        put(static_cast<std::uint32_t>(items.size()));
+        buf_.resize(buf_.size() + 4 * items.size(), '\0');
+        for (std::size_t i = 0; i < items.size(); ++i) link(pos + 4 + 4 * i, items[i](*this));
+        return pos;
     }
-    void setPerformance(double score) {
-        perfScore_ = clamp(score, 0.0, 100.0);
+    // A vector of structs made of 8-byte fields; the elements start 8-aligned.
+    std::size_t structs(const void* data, std::size_t count, std::size_t elementBytes) {
+        pad(4);
+        if (buf_.size() % 8 == 0) put<std::uint32_t>(0);
+        const std::size_t pos = buf_.size();
+        put(static_cast<std::uint32_t>(count));
+        buf_.append(static_cast<const char*>(data), count * elementBytes);
+        return pos;
     }
-    std::string toCSV() const {
-        std::ostringstream oss;
-        oss << name_ << "," << difficulty_ << "," << importance_ << "," << perfScore_ << "," << allocatedHours_;
-        return oss.str();
+    // The finished buffer: root offset, then everything root writes, padded to 8.
+    std::string finish(const Child& root) {
+        buf_.assign(4, '\0');
+        link(0, root(*this));
+        pad(8);
+        return std::move(buf_);
     }
-    static Subject fromCSV(const std::string& line) {
-        std::istringstream iss(line);
-        std::string tok;
-        std::vector<std::string> parts;
-        while (std::getline(iss, tok, ',')) parts.push_back(tok);
-        if (parts.size() < 5) throw std::runtime_error("Invalid subject CSV line");
-        Subject s(parts[0], std::stoi(parts[1]), std::stoi(parts[2]), std::stod(parts[3]));
-        s.setAllocatedHours(std::stod(parts[4]));
-        return s;
+};
+// Streams planners to an Arrow IPC stream file (pyarrow.ipc.open_stream and the
+// other Arrow readers), one row per subject:
+//   student, subject: dictionary<int32, utf8>      difficulty, importance: int8
+//   perfScore, allocatedHours, dailyHours: float64  dueDay: int32, null without an exam
+//   history: list<float64>, oldest score first
+// Rows are buffered into record batches of batchRows. Names first seen in a
+// batch are sent just before it as (delta) dictionary batches, so memory stays
+// at one batch plus the subject dictionary. The stream is written to a temp
+// file and renamed over path by finish(); without finish() it is discarded.
+class ArrowExporter {
+private:
+    struct FieldNode { std::int64_t length, nullCount; };
+    struct BufferSpec { std::int64_t offset, length; };
+    struct Body {
+        std::string bytes;
+        std::vector<FieldNode> nodes;
+        std::vector<BufferSpec> buffers;
+        void add(const void* data, std::size_t size) {
+            buffers.push_back({static_cast<std::int64_t>(bytes.size()), static_cast<std::int64_t>(size)});
+            bytes.append(static_cast<const char*>(data), size);
+            bytes.resize((bytes.size() + 7) / 8 * 8, '\0');
+        }
+        template <typename T>
+        void add(const std::vector<T>& v) { add(v.data(), v.size() * sizeof(T)); }
+        void noNulls() { add(nullptr, 0); }
+    };
+    // Entries added since the last dictionary batch for one dictionary.
+    struct DictionaryDelta {
+        std::int64_t id;
+        std::int32_t size = 0;
+        bool sent = false;
+        std::vector<std::int32_t> offsets{0};
+        std::string chars = {};
+        std::int32_t append(std::string_view s) {
+            chars.append(s);
+            offsets.push_back(static_cast<std::int32_t>(chars.size()));
+            return size++;
+        }
+    };
+    static constexpr std::uint8_t kTypeInt = 2, kTypeFloat = 3, kTypeUtf8 = 5, kTypeList = 12;
+    static constexpr std::uint8_t kHeaderSchema = 1, kHeaderDictionary = 2, kHeaderRecordBatch = 3;
+    std::string path_;
+    std::string tmp_;
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> file_{nullptr, &std::fclose};
+    std::size_t batchRows_;
+    std::uint64_t rowsWritten_ = 0;
+    bool batchWritten_ = false;
+    DictionaryDelta students_{0};
+    DictionaryDelta subjects_{1};
+    std::unordered_map<NameId, std::int32_t> subjectCodes_;
+    std::vector<std::int32_t> student_, subject_, dueDay_, historyOffsets_{0};
+    std::vector<std::int8_t> difficulty_, importance_;
+    std::vector<double> perfScore_, allocatedHours_, dailyHours_, history_;
+    std::vector<std::uint8_t> dueValid_;
+    std::int64_t dueNulls_ = 0;
+    void write(const void* data, std::size_t size) {
+        if (std::fwrite(data, 1, size, file_.get()) != size) throw std::runtime_error("Failed writing file: " + path_);
     }
-    std::string summary() const {
-        std::ostringstream oss;
-        oss << std::left << std::setw(15) << name_
-            << " | diff: " << std::setw(2) << difficulty_
-            << " imp: " << std::setw(2) << importance_
-            << " perf: " << std::setw(6) << fmtd(perfScore_,1)
-            << " hrs: " << std::setw(5) << fmtd(allocatedHours_,2);
-        return oss.str();
+    void writeMessage(std::uint8_t headerType, const FlatBufferWriter::Child& header, const std::string& body) {
+        const std::string meta = FlatBufferWriter().finish([&](FlatBufferWriter& w) {
+            return w.table({{0, 2, 4},  // MetadataVersion V5
+                            {1, 1, headerType},
+                            {2, 0, 0, header},
+                            {3, 8, body.size()}});
+        });
+        const std::uint32_t prefix[2] = {0xFFFFFFFFu, static_cast<std::uint32_t>(meta.size())};
+        write(prefix, sizeof prefix);
+        write(meta.data(), meta.size());
+        write(body.data(), body.size());
     }
-};
-struct Schedule {
-    std::map<std::string, double> alloc;
-    Schedule() = default;
-    double totalHours() const {
-        double sum = 0.0;
-        for (const auto& kv : alloc) sum += kv.second;
-        return sum;
+    static FlatBufferWriter::Child recordBatch(std::int64_t length, const Body& body) {
+        return [length, &body](FlatBufferWriter& w) {
+            return w.table({{0, 8, static_cast<std::uint64_t>(length)},
+                            {1, 0, 0, [&](FlatBufferWriter& v) { return v.structs(body.nodes.data(), body.nodes.size(), sizeof(FieldNode)); }},
+                            {2, 0, 0, [&](FlatBufferWriter& v) { return v.structs(body.buffers.data(), body.buffers.size(), sizeof(BufferSpec)); }}});
+        };
     }
-    Schedule operator+(const Schedule& other) const {
-        Schedule out = *this;
-        for (const auto& kv : other.alloc) out.alloc[kv.first] += kv.second;
-        return out;
+    static FlatBufferWriter::Child intType(int bits) {
+        return [bits](FlatBufferWriter& w) { return w.table({{0, 4, static_cast<std::uint64_t>(bits)}, {1, 1, 1}}); };
     }
-    std::string toString() const {
-        std::ostringstream oss;
-        oss << "Schedule (total " << fmtd(totalHours(),2) << " hrs):\n";
-        for (const auto& kv : alloc)
-            oss << "  - " << std::left << std::setw(15) << kv.first << " -> " << fmtd(kv.second,2) << " hrs\n";
-        return oss.str();
+    static FlatBufferWriter::Child emptyTable() {
+        return [](FlatBufferWriter& w) { return w.table({}); };
+    }
+    static FlatBufferWriter::Child field(std::string name, bool nullable, std::uint8_t type, FlatBufferWriter::Child typeTable,
+                                         std::vector<FlatBufferWriter::Child> children = {}, int dictionaryId = -1) {
+        return [=](FlatBufferWriter& w) {
+            std::vector<FlatBufferWriter::Field> f{{0, 0, 0, [&](FlatBufferWriter& v) { return v.string(name); }},
+                                                  {1, 1, nullable},
+                                                  {2, 1, type},
+                                                  {3, 0, 0, typeTable},
+                                                  {5, 0, 0, [&](FlatBufferWriter& v) { return v.tables(children); }}};
+            if (dictionaryId >= 0)
+                f.push_back({4, 0, 0, [&](FlatBufferWriter& v) {
+                    return v.table({{0, 8, static_cast<std::uint64_t>(dictionaryId)}, {1, 0, 0, intType(32)}});
+                }});
+            return w.table(std::move(f));
+        };
+    }
+    void writeSchema() {
+        auto float64 = [](FlatBufferWriter& w) { return w.table({{0, 2, 2}}); };  // Precision DOUBLE
+        const std::vector<FlatBufferWriter::Child> fields{
+            field("student", false, kTypeUtf8, emptyTable(), {}, 0),
+            field("subject", false, kTypeUtf8, emptyTable(), {}, 1),
+            field("difficulty", false, kTypeInt, intType(8)),
+            field("importance", false, kTypeInt, intType(8)),
+            field("perfScore", false, kTypeFloat, float64),
+            field("allocatedHours", false, kTypeFloat, float64),
+            field("dueDay", true, kTypeInt, intType(32)),
+            field("dailyHours", false, kTypeFloat, float64),
+            field("history", false, kTypeList, emptyTable(), {field("item", false, kTypeFloat, float64)}),
+        };
+        writeMessage(kHeaderSchema, [&](FlatBufferWriter& w) {
+            return w.table({{1, 0, 0, [&](FlatBufferWriter& v) { return v.tables(fields); }}});
+        }, {});
+    }
+    void writeDictionary(DictionaryDelta& d) {
+        if (d.sent && d.offsets.size() == 1) return;
+        Body body;
+        body.nodes.push_back({static_cast<std::int64_t>(d.offsets.size() - 1), 0});
+        body.noNulls();
+        body.add(d.offsets);
+        body.add(d.chars.data(), d.chars.size());
+        const bool delta = d.sent;
+        writeMessage(kHeaderDictionary, [&](FlatBufferWriter& w) {
+            return w.table({{0, 8, static_cast<std::uint64_t>(d.id)},
+                            {1, 0, 0, recordBatch(static_cast<std::int64_t>(d.offsets.size() - 1), body)},
+                            {2, 1, delta}});
+        }, body.bytes);
+        d.sent = true;
+        d.offsets.assign(1, 0);
+        d.chars.clear();
+    }
+    void flush() {
+        const std::size_t rows = student_.size();
+        if (rows == 0) return;
+        writeDictionary(students_);
+        writeDictionary(subjects_);
+        const auto n = static_cast<std::int64_t>(rows);
+        Body body;
+        for (auto* column : {&student_, &subject_}) {
+            body.nodes.push_back({n, 0});
+            body.noNulls();
+            body.add(*column);
+        }
+        for (auto* column : {&difficulty_, &importance_}) {
+            body.nodes.push_back({n, 0});
+            body.noNulls();
+            body.add(*column);
+        }
+        for (auto* column : {&perfScore_, &allocatedHours_}) {
+            body.nodes.push_back({n, 0});
+            body.noNulls();
+            body.add(*column);
+        }
+        body.nodes.push_back({n, dueNulls_});
+        if (dueNulls_) body.add(dueValid_);
+        else body.noNulls();
+        body.add(dueDay_);
+        body.nodes.push_back({n, 0});
+        body.noNulls();
+        body.add(dailyHours_);
+        body.nodes.push_back({n, 0});
+        body.noNulls();
+        body.add(historyOffsets_);
+        body.nodes.push_back({static_cast<std::int64_t>(history_.size()), 0});
+        body.noNulls();
+        body.add(history_);
+        writeMessage(kHeaderRecordBatch, recordBatch(n, body), body.bytes);
+        batchWritten_ = true;
+        rowsWritten_ += rows;
+        for (auto* v : {&student_, &subject_, &dueDay_}) v->clear();
+        for (auto* v : {&difficulty_, &importance_}) v->clear();
+        for (auto* v : {&perfScore_, &allocatedHours_, &dailyHours_, &history_}) v->clear();
+        dueValid_.clear();
+        dueNulls_ = 0;
+        historyOffsets_.assign(1, 0);
+    }
+public:
+    explicit ArrowExporter(std::string path, std::size_t batchRows = 1 << 16)
+        : path_(std::move(path)), batchRows_(std::max<std::size_t>(batchRows, 1)) {
+        static std::atomic<unsigned> tmpCounter{0};
+        tmp_ = path_ + ".tmp" + std::to_string(tmpCounter.fetch_add(1));
+        file_.reset(std::fopen(tmp_.c_str(), "wb"));
+        if (!file_) throw std::runtime_error("Unable to open file for writing: " + path_);
+        writeSchema();
+    }
+    ArrowExporter(const ArrowExporter&) = delete;
+    ArrowExporter& operator=(const ArrowExporter&) = delete;
+    ~ArrowExporter() {
+        if (file_) {
+            file_.reset();
+            std::remove(tmp_.c_str());
+        }
+    }
+    void add(std::string_view student, const StudyPlanner& planner) {
+        if (!file_) throw std::runtime_error("Export already finished: " + path_);
+        if (planner.subjectCount() == 0) return;
+        const std::int32_t code = students_.append(student);
+        const double daily = planner.getTotalDailyHours();
+        planner.forEachSubject([&](std::size_t, const Subject& s) {
+            auto [it, fresh] = subjectCodes_.try_emplace(s.nameId(), 0);
+            if (fresh) it->second = subjects_.append(s.nameView());
+            const std::size_t row = student_.size();
+            student_.push_back(code);
+            subject_.push_back(it->second);
+            difficulty_.push_back(static_cast<std::int8_t>(s.difficulty()));
+            importance_.push_back(static_cast<std::int8_t>(s.importance()));
+            perfScore_.push_back(s.perfScore());
+            allocatedHours_.push_back(s.allocatedHours());
+            dailyHours_.push_back(daily);
+            if (row % 8 == 0) dueValid_.push_back(0);
+            if (s.hasDueDay()) dueValid_.back() |= static_cast<std::uint8_t>(1u << (row % 8));
+            else ++dueNulls_;
+            dueDay_.push_back(s.hasDueDay() ? s.dueDay() : 0);
+            const std::size_t h = history_.size();
+            history_.resize(h + s.history().size());
+            s.history().copyTo(history_.data() + h);
+            historyOffsets_.push_back(static_cast<std::int32_t>(history_.size()));
+            if (student_.size() >= batchRows_) flush();
+        });
+    }
+    std::uint64_t rows() const { return rowsWritten_ + student_.size(); }
+    // Writes the last batch and the end-of-stream marker, then publishes the file.
+    void finish() {
+        if (!file_) throw std::runtime_error("Export already finished: " + path_);
+        try {
+            flush();
+            if (!batchWritten_) {
+                writeDictionary(students_);
+                writeDictionary(subjects_);
+            }
+            const std::uint32_t eos[2] = {0xFFFFFFFFu, 0};
+            write(eos, sizeof eos);
+            bool ok = std::fflush(file_.get()) == 0;
+#if defined(SSP_HAVE_FSYNC)
+            ok = ok && ::fsync(::fileno(file_.get())) == 0;
+#endif
+            if (!ok || std::fclose(file_.release()) != 0) throw std::runtime_error("Failed writing file: " + path_);
+        } catch (...) {
+            file_.reset();
+            std::remove(tmp_.c_str());
+            throw;
+        }
+        replaceFile(tmp_, path_);
     }
 };
-class StudyPlanner {
+// Shard file: a 48-byte header, then one record per student:
+//   uint64 snapshotBytes, uint32 idBytes, uint32 0, id, pad to 8, snapshot, pad to 8
+// where snapshot is a planner snapshot as written by writeSnapshot. Files are
+// named shard-<generation>-<index>-of-<count>.ssp; a save writes a whole new
+// generation and only then deletes the older ones.
+struct ShardFileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t endianTag;
+    std::uint64_t generation;
+    std::uint32_t shardIndex;
+    std::uint32_t shardCount;
+    std::uint64_t students;
+    std::uint64_t reserved;
+};
+static_assert(sizeof(ShardFileHeader) == 48, "shard header must stay 48 bytes");
+constexpr char kShardMagic[8] = {'S', 'S', 'P', 'S', 'H', 'A', 'R', 'D'};
+constexpr std::uint32_t kShardFileVersion = 1;
+// Partitions student planners over N shards by a jump consistent hash of the
+// student id, so growing from N to N + 1 shards moves only ~1/(N + 1) of them.
+// Each shard owns its planners and one worker thread; every operation on a
+// student runs as a task on its shard's worker, so planners need no locks.
+// Batch scheduling scatters one task per shard and gathers the totals.
+class ShardedPlannerStore {
+public:
+    struct ShardStats {
+        std::size_t students = 0;
+        std::size_t subjects = 0;
+        double allocatedHours = 0.0;
+    };
 private:
-    std::vector<std::shared_ptr<Subject>> subjects_;
-    double totalDailyHours_;
+    using StudentMap = std::unordered_map<std::string, StudyPlanner, NameHash, std::equal_to<>>;
+    using Student = std::pair<std::string, StudyPlanner>;
+    struct Shard {
+        StudentMap planners;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::deque<std::function<void()>> tasks;
+        bool stop = false;
+        std::thread worker;
+        Shard() : worker([this] { loop(); }) {}
+        ~Shard() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stop = true;
+            }
+            wake.notify_one();
+            worker.join();
+        }
+        void loop() {
+            while (true) {
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    wake.wait(lock, [&] { return stop || !tasks.empty(); });
+                    if (tasks.empty()) return;
+                    task = std::move(tasks.front());
+                    tasks.pop_front();
+                }
+                task();
+            }
+        }
+        template <typename Fn>
+        auto submit(Fn fn) -> std::future<std::invoke_result_t<Fn&, Shard&>> {
+            using R = std::invoke_result_t<Fn&, Shard&>;
+            auto task = std::make_shared<std::packaged_task<R()>>([this, fn = std::move(fn)]() mutable { return fn(*this); });
+            std::future<R> result = task->get_future();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                tasks.emplace_back([task] { (*task)(); });
+            }
+            wake.notify_one();
+            return result;
+        }
+    };
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::string directory_;
+    std::uint64_t generation_ = 0;        // guarded by persist_
+    std::mutex persist_;                  // one save() or load() at a time; taken before topology_
+    mutable std::shared_mutex topology_;
+    Shard& owner(std::string_view id) const { return *shards_[shardOf(id, static_cast<unsigned>(shards_.size()))]; }
+    void insertAll(std::vector<Student>& students) {
+        std::vector<std::future<void>> done;
+        done.reserve(students.size());
+        for (auto& st : students) {
+            done.push_back(owner(st.first).submit([st = std::move(st)](Shard& sh) mutable {
+                if (sh.planners.find(st.first) != sh.planners.end())
+                    throw std::runtime_error("Duplicate student: " + st.first);
+                sh.planners.emplace(std::move(st.first), std::move(st.second));
+            }));
+        }
+        for (auto& f : done) f.get();
+    }
+    static std::vector<Student> readShardFile(const std::string& path) {
+        const MappedFile file(path);
+        std::vector<Student> out;
+        forEachShardRecord(file.data(), file.size(), path, [&](std::string_view id, std::span<const char> snapshot) {
+            Student st{std::string(id), StudyPlanner{}};
+            st.second.loadSnapshot(SnapshotView(snapshot, path));
+            out.push_back(std::move(st));
+        });
+        return out;
+    }
 public:
-    StudyPlanner() : totalDailyHours_(4.0) {}
-    void addSubject(const std::string& name, int diff, int imp, double perf = 100.0) {
-        if (findSubject(name)) throw std::runtime_error("Subject already exists: " + name);
-        subjects_.push_back(std::make_shared<Subject>(name, diff, imp, perf));
+    // FNV-1a, so shard placement does not depend on the standard library's hash.
+    static std::uint64_t stableHash(std::string_view id) {
+        std::uint64_t h = 14695981039346656037ull;
+        for (unsigned char c : id) h = (h ^ c) * 1099511628211ull;
+        return h;
     }
-    void removeSubject(const std::string& name) {
-        auto it = std::remove_if(subjects_.begin(), subjects_.end(),
-            [&](const std::shared_ptr<Subject>& s){ return s->name() == name; });
-        subjects_.erase(it, subjects_.end());
+    // Lamping & Veach jump consistent hash.
+    static unsigned jumpHash(std::uint64_t key, unsigned buckets) {
+        std::int64_t b = -1, j = 0;
+        while (j < static_cast<std::int64_t>(buckets)) {
+            b = j;
+            key = key * 2862933555777941757ull + 1;
+            j = static_cast<std::int64_t>((b + 1) * (double(1ll << 31) / double((key >> 33) + 1)));
+        }
+        return static_cast<unsigned>(b);
     }
-    std::shared_ptr<Subject> findSubject(const std::string& name) const {
-        for (const auto& s : subjects_) if (s->name() == name) return s;
-        return nullptr;
+    static unsigned shardOf(std::string_view id, unsigned shards) { return jumpHash(stableHash(id), shards); }
+    // Fills files (in shard order) with the newest complete generation in
+    // directory, or leaves it empty; returns the highest generation seen.
+    static std::uint64_t newestGeneration(const std::string& directory, std::vector<std::string>& files) {
+        std::map<std::uint64_t, std::map<unsigned, std::string>> found;
+        std::map<std::uint64_t, unsigned> counts;
+        std::uint64_t newest = 0;
+        for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+            std::uint64_t g;
+            unsigned idx, n;
+            if (!parseShardFileName(entry.path().filename().string(), g, idx, n)) continue;
+            newest = std::max(newest, g);
+            if (counts.emplace(g, n).first->second != n) continue;
+            found[g][idx] = entry.path().string();
+        }
+        files.clear();
+        for (auto it = found.rbegin(); it != found.rend(); ++it) {
+            if (it->second.size() != counts[it->first]) continue;
+            for (auto& [idx, path] : it->second) files.push_back(std::move(path));
+            break;
+        }
+        return newest;
     }
-    void setTotalDailyHours(double hrs) {
-        if (hrs < 0.0) throw std::runtime_error("Hours must be non-negative");
-        totalDailyHours_ = hrs;
+    static std::string shardFileName(const std::string& directory, std::uint64_t generation, unsigned index,
+                                     unsigned count) {
+        return (std::filesystem::path(directory) / ("shard-" + std::to_string(generation) + "-" + std::to_string(index) +
+                                                     "-of-" + std::to_string(count) + ".ssp")).string();
     }
-    double getTotalDailyHours() const { return totalDailyHours_; }
-    Schedule generateSchedule() {
-        Schedule schedule;
-        if (subjects_.empty()) return schedule;
-        std::vector<double> weights;
-        for (const auto& s : subjects_) weights.push_back(s->priorityWeight());
-        double sumWeights = std::accumulate(weights.begin(), weights.end(), 0.0);
-        if (sumWeights <= 0.0) {
-            double per = totalDailyHours_ / static_cast<double>(subjects_.size());
-            for (const auto& s : subjects_) { schedule.alloc[s->name()] = per; s->setAllocatedHours(per); }
-            return schedule;
-        }
-        const double minSlot = 0.25;
-        std::vector<double> rawAlloc(weights.size(), 0.0);
-        for (size_t i = 0; i < weights.size(); ++i) {
-            rawAlloc[i] = (weights[i] / sumWeights) * totalDailyHours_;
-            rawAlloc[i] = std::max(rawAlloc[i], minSlot);
-        }
-        double rawSum = std::accumulate(rawAlloc.begin(), rawAlloc.end(), 0.0);
-        if (rawSum > 0.0) {
-            for (size_t i = 0; i < rawAlloc.size(); ++i)
-                rawAlloc[i] *= (totalDailyHours_ / rawSum);
-        }
-        for (size_t i = 0; i < subjects_.size(); ++i) {
-            double hrs = std::round(rawAlloc[i] * 100.0) / 100.0;
-            schedule.alloc[subjects_[i]->name()] = hrs;
-            subjects_[i]->setAllocatedHours(hrs);
-        }
-        return schedule;
+    // Parses shard-<generation>-<index>-of-<count>.ssp.
+    static bool parseShardFileName(const std::string& name, std::uint64_t& generation, unsigned& index, unsigned& count) {
+        std::string_view v(name);
+        auto number = [&](auto& out, std::string_view prefix) {
+            if (v.substr(0, prefix.size()) != prefix) return false;
+            v.remove_prefix(prefix.size());
+            auto [ptr, ec] = std::from_chars(v.data(), v.data() + v.size(), out);
+            if (ec != std::errc() || ptr == v.data()) return false;
+            v.remove_prefix(static_cast<std::size_t>(ptr - v.data()));
+            return true;
+        };
+        return number(generation, "shard-") && number(index, "-") && number(count, "-of-") && v == ".ssp" &&
+               index < count;
     }
-    void adaptiveAdjust(double lowThreshold = 70.0, double highThreshold = 90.0,
-                        double boostFactor = 1.15, double reduceFactor = 0.9) {
-        for (auto& s : subjects_) {
-            double perf = s->perfScore();
-            double current = s->allocatedHours();
-            double newHours = current;
-            if (perf < lowThreshold) newHours = current * boostFactor;
-            else if (perf > highThreshold) newHours = current * reduceFactor;
-            newHours = clamp(newHours, 0.1, totalDailyHours_);
-            s->setAllocatedHours(newHours);
+    // Validates the header of a shard file held in memory.
+    static ShardFileHeader shardFileHeader(const char* base, std::size_t bytes, const std::string& path) {
+        ShardFileHeader h{};
+        if (bytes < sizeof h) throw std::runtime_error("Not a shard file: " + path);
+        std::memcpy(&h, base, sizeof h);
+        if (std::memcmp(h.magic, kShardMagic, sizeof h.magic) != 0 || h.endianTag != kSnapshotEndianTag ||
+            h.version != kShardFileVersion)
+            throw std::runtime_error("Not a shard file: " + path);
+        return h;
+    }
+    // Calls fn(id, snapshot bytes) for each record of a shard file held in
+    // memory (8-byte aligned), without parsing the snapshots.
+    template <typename Fn>
+    static void forEachShardRecord(const char* base, std::size_t bytes, const std::string& path, Fn&& fn) {
+        const ShardFileHeader h = shardFileHeader(base, bytes, path);
+        std::size_t pos = sizeof h;
+        for (std::uint64_t k = 0; k < h.students; ++k) {
+            std::uint64_t blob;
+            std::uint32_t idBytes;
+            if (pos + 16 > bytes) throw std::runtime_error("Truncated shard file: " + path);
+            std::memcpy(&blob, base + pos, 8);
+            std::memcpy(&idBytes, base + pos + 8, 4);
+            pos += 16;
+            const std::size_t snapAt = (pos + idBytes + 7) & ~std::size_t(7);
+            if (idBytes > bytes || blob > bytes || snapAt + blob > bytes)
+                throw std::runtime_error("Truncated shard file: " + path);
+            fn(std::string_view(base + pos, idBytes), std::span<const char>(base + snapAt, blob));
+            pos = (snapAt + blob + 7) & ~std::size_t(7);
         }
-        double sum = 0.0;
-        for (const auto& s : subjects_) sum += s->allocatedHours();
-        if (sum <= 0) return;
-        double scale = totalDailyHours_ / sum;
-        for (auto& s : subjects_)
-            s->setAllocatedHours(std::round(s->allocatedHours() * scale * 100.0) / 100.0);
     }
-    void recordPerformance(const std::string& name, double score) {
-        auto sp = findSubject(name);
-        if (!sp) throw std::runtime_error("Subject not found: " + name);
-        sp->updatePerformance(score);
+    // Writes a shard file atomically. each(record) calls record(id, body) once
+    // per student (students in all), where body(std::ostream&) writes the
+    // planner snapshot; record returns the snapshot's {offset, bytes} in the file.
+    template <typename Each>
+    static void writeShardFile(const std::string& path, std::uint64_t students, std::uint64_t generation,
+                               unsigned index, unsigned count, Each&& each) {
+        const std::string tmp = path + ".tmp";
+        {
+            std::ofstream ofs(tmp, std::ios::binary | std::ios::trunc);
+            if (!ofs) throw std::runtime_error("Unable to open file for writing: " + tmp);
+            static const char zeros[8] = {};
+            auto pad = [&] { ofs.write(zeros, (8 - static_cast<std::uint64_t>(ofs.tellp()) % 8) % 8); };
+            ShardFileHeader h{};
+            std::memcpy(h.magic, kShardMagic, sizeof h.magic);
+            h.version = kShardFileVersion;
+            h.endianTag = kSnapshotEndianTag;
+            h.generation = generation;
+            h.shardIndex = index;
+            h.shardCount = count;
+            h.students = students;
+            ofs.write(reinterpret_cast<const char*>(&h), sizeof h);
+            std::uint64_t written = 0;
+            each([&](std::string_view id, auto&& body) {
+                const auto lengthAt = ofs.tellp();
+                std::uint64_t blob = 0;
+                const std::uint32_t idBytes = static_cast<std::uint32_t>(id.size()), zero = 0;
+                ofs.write(reinterpret_cast<const char*>(&blob), 8);
+                ofs.write(reinterpret_cast<const char*>(&idBytes), 4);
+                ofs.write(reinterpret_cast<const char*>(&zero), 4);
+                ofs.write(id.data(), static_cast<std::streamsize>(id.size()));
+                pad();
+                const auto start = ofs.tellp();
+                body(static_cast<std::ostream&>(ofs));
+                const auto end = ofs.tellp();
+                blob = static_cast<std::uint64_t>(end - start);
+                ofs.seekp(lengthAt);
+                ofs.write(reinterpret_cast<const char*>(&blob), 8);
+                ofs.seekp(end);
+                pad();
+                ++written;
+                return std::pair<std::uint64_t, std::uint64_t>(static_cast<std::uint64_t>(start), blob);
+            });
+            if (written != students) throw std::runtime_error("Shard file student count mismatch: " + tmp);
+            if (!ofs.flush()) throw std::runtime_error("Failed writing shard file: " + tmp);
+        }
+        syncFile(tmp);
+        replaceFile(tmp, path);
     }
-    void saveToFile(const std::string& filename) const {
-        std::ofstream ofs(filename, std::ios::trunc);
-        if (!ofs) throw std::runtime_error("Unable to open file for writing: " + filename);
-        ofs << "name,difficulty,importance,perfScore,allocatedHours\n";
-        for (const auto& s : subjects_) ofs << s->toCSV() << "\n";
+    static void writeShardFile(const std::string& path, const StudentMap& planners, std::uint64_t generation,
+                               unsigned index, unsigned count) {
+        writeShardFile(path, planners.size(), generation, index, count, [&](auto&& record) {
+            for (const auto& [id, planner] : planners)
+                record(id, [&](std::ostream& os) {
+                    writeSnapshot(os, planner.toStore(), planner.getTotalDailyHours(), planner.currentDay(),
+                                  planner.allocationMode());
+                });
+        });
     }
-    void loadFromFile(const std::string& filename) {
-        std::ifstream ifs(filename);
-        if (!ifs) throw std::runtime_error("Unable to open file for reading: " + filename);
-        std::string line;
-        subjects_.clear();
-        bool first = true;
-        while (std::getline(ifs, line)) {
-            if (line.empty()) continue;
-            if (first && line.find("name,difficulty,importance") != std::string::npos) { first = false; continue; }
-            first = false;
-            Subject sub = Subject::fromCSV(line);
-            subjects_.push_back(std::make_shared<Subject>(sub));
+    // With a directory, the newest complete generation of shard files in it is
+    // loaded (whatever shard count it was written with) and spread over shards.
+    explicit ShardedPlannerStore(unsigned shards, std::string directory = {}) : directory_(std::move(directory)) {
+        shards_.reserve(std::max(1u, shards));
+        for (unsigned i = 0; i < std::max(1u, shards); ++i) shards_.push_back(std::make_unique<Shard>());
+        if (!directory_.empty() && std::filesystem::is_directory(directory_)) load();
+    }
+    ShardedPlannerStore(const ShardedPlannerStore&) = delete;
+    ShardedPlannerStore& operator=(const ShardedPlannerStore&) = delete;
+    unsigned shardCount() const {
+        std::shared_lock<std::shared_mutex> lock(topology_);
+        return static_cast<unsigned>(shards_.size());
+    }
+    unsigned shardOf(std::string_view id) const { return shardOf(id, shardCount()); }
+    std::future<void> addStudent(std::string id, StudyPlanner planner) {
+        std::shared_lock<std::shared_mutex> lock(topology_);
+        Shard& sh = owner(id);
+        return sh.submit([id = std::move(id), planner = std::move(planner)](Shard& s) mutable {
+            if (s.planners.find(id) != s.planners.end()) throw std::runtime_error("Student already exists: " + id);
+            s.planners.emplace(std::move(id), std::move(planner));
+        });
+    }
+    std::future<bool> removeStudent(const std::string& id) {
+        std::shared_lock<std::shared_mutex> lock(topology_);
+        return owner(id).submit([id](Shard& s) { return s.planners.erase(id) > 0; });
+    }
+    // Runs fn(StudyPlanner&) on the student's shard worker.
+    template <typename Fn>
+    auto withStudent(std::string id, Fn fn) -> std::future<std::invoke_result_t<Fn&, StudyPlanner&>> {
+        std::shared_lock<std::shared_mutex> lock(topology_);
+        return owner(id).submit([id = std::move(id), fn = std::move(fn)](Shard& s) mutable {
+            auto it = s.planners.find(id);
+            if (it == s.planners.end()) throw std::runtime_error("Student not found: " + id);
+            return fn(it->second);
+        });
+    }
+    // Replans (and optionally adjusts) every planner, one task per shard; returns per-shard totals.
+    std::vector<ShardStats> scheduleAll(const BatchOptions& opts = {}) {
+        std::shared_lock<std::shared_mutex> lock(topology_);
+        std::vector<std::future<ShardStats>> parts;
+        parts.reserve(shards_.size());
+        for (auto& sh : shards_) {
+            parts.push_back(sh->submit([opts](Shard& s) {
+                ShardStats st;
+                std::vector<double> scratch;
+                for (auto& [id, planner] : s.planners) {
+                    double hours = 0.0;
+                    if (opts.generate) hours = planner.replan(scratch);
+                    if (opts.adjust) hours = planner.adaptiveAdjust(scratch, opts.adjustParams);
+                    ++st.students;
+                    st.subjects += planner.subjectCount();
+                    st.allocatedHours += hours;
+                }
+                return st;
+            }));
+        }
+        std::vector<ShardStats> out;
+        out.reserve(parts.size());
+        for (auto& f : parts) out.push_back(f.get());
+        return out;
+    }
+    std::size_t studentCount() {
+        std::size_t n = 0;
+        std::shared_lock<std::shared_mutex> lock(topology_);
+        std::vector<std::future<std::size_t>> parts;
+        for (auto& sh : shards_) parts.push_back(sh->submit([](Shard& s) { return s.planners.size(); }));
+        for (auto& f : parts) n += f.get();
+        return n;
+    }
+    // Streams every student into out, one shard at a time on its worker, so only
+    // one shard is being read while the rest keep serving.
+    void exportArrow(ArrowExporter& out) {
+        std::shared_lock<std::shared_mutex> lock(topology_);
+        for (auto& sh : shards_)
+            sh->submit([&out](Shard& s) {
+                for (const auto& [id, planner] : s.planners) out.add(id, planner);
+            }).get();
+    }
+    // Changes the shard count, moving only the students whose shard changes;
+    // returns how many moved. Tasks already queued finish first.
+    std::size_t rebalance(unsigned shards) {
+        shards = std::max(1u, shards);
+        std::unique_lock<std::shared_mutex> lock(topology_);
+        if (shards == shards_.size()) return 0;
+        std::vector<std::future<std::vector<Student>>> parts;
+        for (unsigned i = 0; i < shards_.size(); ++i) {
+            parts.push_back(shards_[i]->submit([i, shards](Shard& s) {
+                std::vector<Student> moving;
+                for (auto it = s.planners.begin(); it != s.planners.end();) {
+                    if (shardOf(it->first, shards) != i) {
+                        auto node = s.planners.extract(it++);
+                        moving.emplace_back(std::move(node.key()), std::move(node.mapped()));
+                    } else {
+                        ++it;
+                    }
+                }
+                return moving;
+            }));
         }
+        std::vector<Student> moving;
+        for (auto& f : parts)
+            for (auto& st : f.get()) moving.push_back(std::move(st));
+        if (shards < shards_.size()) shards_.resize(shards);
+        while (shards_.size() < shards) shards_.push_back(std::make_unique<Shard>());
+        insertAll(moving);
+        return moving.size();
     }
-    void showSubjects() const {
-        if (subjects_.empty()) { std::cout << "(No subjects available)\n"; return; }
-        std::cout << "Subjects:\n";
-        for (const auto& s : subjects_) std::cout << "  " << s->summary() << "\n";
+    // Writes one file per shard (in parallel, each atomically) as a new
+    // generation, then removes the older generations. Concurrent saves and
+    // loads run one after another.
+    void save() {
+        if (directory_.empty()) throw std::runtime_error("Sharded store has no directory");
+        std::lock_guard<std::mutex> persisting(persist_);
+        std::filesystem::create_directories(directory_);
+        std::shared_lock<std::shared_mutex> lock(topology_);
+        const std::uint64_t generation = generation_ + 1;
+        const unsigned count = static_cast<unsigned>(shards_.size());
+        std::vector<std::future<void>> parts;
+        for (unsigned i = 0; i < count; ++i) {
+            parts.push_back(shards_[i]->submit([path = shardFileName(directory_, generation, i, count), generation, i, count](Shard& s) {
+                writeShardFile(path, s.planners, generation, i, count);
+            }));
+        }
+        for (auto& f : parts) f.get();
+        generation_ = generation;
+        for (const auto& entry : std::filesystem::directory_iterator(directory_)) {
+            std::uint64_t g;
+            unsigned idx, n;
+            if (parseShardFileName(entry.path().filename().string(), g, idx, n) && g < generation)
+                std::filesystem::remove(entry.path());
+        }
     }
-    Schedule showCurrentSchedule() const {
-        Schedule sch;
-        for (const auto& s : subjects_) sch.alloc[s->name()] = s->allocatedHours();
-        return sch;
+    // Replaces the contents with the newest complete generation on disk.
+    void load() {
+        std::lock_guard<std::mutex> persisting(persist_);
+        std::vector<std::string> files;
+        generation_ = std::max(generation_, newestGeneration(directory_, files));
+        if (files.empty()) return;
+        std::unique_lock<std::shared_mutex> lock(topology_);
+        std::vector<std::future<std::vector<Student>>> parts;
+        for (std::size_t k = 0; k < files.size(); ++k)
+            parts.push_back(shards_[k % shards_.size()]->submit([path = files[k]](Shard&) { return readShardFile(path); }));
+        std::vector<Student> students;
+        for (auto& f : parts)
+            for (auto& st : f.get()) students.push_back(std::move(st));
+        std::vector<std::future<void>> cleared;
+        for (auto& sh : shards_) cleared.push_back(sh->submit([](Shard& s) { s.planners.clear(); }));
+        for (auto& f : cleared) f.get();
+        insertAll(students);
+    }
+};
+// Opens a ShardedPlannerStore directory without loading it, so startup costs
+// the same whatever the store holds: the newest generation's shard files are
+// mapped and their headers read, nothing more. A shard's id -> snapshot index
+// is built the first time one of its students is looked up, and a planner is
+// hydrated from its snapshot the first time it is asked for. Hydrated
+// planners sit in an LRU; while their estimated size is over the memory
+// budget the least recently used are dropped (and hydrated again on next
+// use), skipping those with unsaved changes or still held by a caller. save()
+// writes a new generation from the hydrated planners and the untouched
+// snapshots' bytes. Not thread-safe.
+class LazyPlannerStore {
+public:
+    struct Stats {
+        std::size_t hydrations = 0;
+        std::size_t evictions = 0;
+        std::size_t resident = 0;
+        std::size_t residentBytes = 0;
+    };
+private:
+    // Unevictable planners met by a trim are rotated to the front, and the trim
+    // after each access looks at no more than this many, so a budget full of
+    // unsaved planners costs an access a bounded scan.
+    static constexpr std::size_t kTrimScan = 32;
+    struct Entry {
+        std::span<const char> snapshot;          // into the shard mapping; empty until a new student is saved
+        std::shared_ptr<StudyPlanner> planner;   // null while not hydrated
+        std::uint64_t savedVersion = 0;
+        bool unsaved = false;
+        std::size_t bytes = 0;
+        std::uint64_t bytesVersion = 0;          // planner version `bytes` was estimated at
+        std::list<Entry*>::iterator lru;
+        // Every write to a planner, generated hours included, bumps its
+        // version, as does the release of subjects a caller was sharing.
+        bool dirty() const { return unsaved || (planner && planner->version() != savedVersion); }
+    };
+    struct Shard {
+        std::string path;
+        MappedFile file;
+        bool indexed = false;
+        std::uint64_t students = 0;
+        std::unordered_map<std::string, Entry, NameHash, std::equal_to<>> entries;
+    };
+    std::string directory_;
+    std::size_t budget_;
+    std::uint64_t generation_ = 0;
+    std::vector<Shard> shards_;
+    std::list<Entry*> lru_;   // hydrated planners, most recently used first
+    std::size_t students_ = 0;
+    bool removed_ = false;    // a student was removed since the last save
+    Stats stats_;
+    static std::size_t estimateBytes(const StudyPlanner& planner) {
+        std::size_t bytes = sizeof(StudyPlanner);
+        planner.forEachSubject([&](std::size_t, const Subject& s) {
+            bytes += sizeof(Subject) + sizeof(std::shared_ptr<Subject>) + 32 + 8 * s.history().size();
+        });
+        return bytes;
+    }
+    void open() {
+        std::vector<std::string> files;
+        generation_ = ShardedPlannerStore::newestGeneration(directory_, files);
+        shards_.reserve(files.size());
+        for (auto& path : files) {
+            Shard& sh = shards_.emplace_back();
+            sh.file = MappedFile(path);
+            sh.students = ShardedPlannerStore::shardFileHeader(sh.file.data(), sh.file.size(), path).students;
+            sh.path = std::move(path);
+            students_ += sh.students;
+        }
+    }
+    void index(Shard& sh) {
+        if (sh.indexed) return;
+        sh.entries.reserve(sh.students);
+        try {
+            ShardedPlannerStore::forEachShardRecord(sh.file.data(), sh.file.size(), sh.path,
+                                                    [&](std::string_view id, std::span<const char> snapshot) {
+                auto [it, fresh] = sh.entries.try_emplace(std::string(id));
+                if (!fresh) throw std::runtime_error("Duplicate student: " + it->first);
+                it->second.snapshot = snapshot;
+            });
+        } catch (...) {
+            sh.entries.clear();
+            throw;
+        }
+        sh.indexed = true;
+    }
+    Shard& shardFor(std::string_view id) {
+        Shard& sh = shards_[ShardedPlannerStore::shardOf(id, static_cast<unsigned>(shards_.size()))];
+        index(sh);
+        return sh;
+    }
+    std::shared_ptr<StudyPlanner> hydrate(Entry& e, const std::string& id) {
+        if (e.planner) {
+            lru_.splice(lru_.begin(), lru_, e.lru);
+        } else {
+            auto planner = std::make_shared<StudyPlanner>();
+            planner->loadSnapshot(SnapshotView(e.snapshot, id));
+            e.savedVersion = planner->version();
+            e.planner = std::move(planner);
+            e.lru = lru_.insert(lru_.begin(), &e);
+            ++stats_.hydrations;
+            ++stats_.resident;
+        }
+        if (const std::uint64_t version = e.planner->version(); e.bytes == 0 || version != e.bytesVersion) {
+            stats_.residentBytes -= e.bytes;
+            e.bytes = estimateBytes(*e.planner);
+            e.bytesVersion = version;
+            stats_.residentBytes += e.bytes;
+        }
+        std::shared_ptr<StudyPlanner> held = e.planner;   // keeps e itself out of the trim
+        trim(kTrimScan);
+        return held;
+    }
+    void drop(Entry& e) {
+        stats_.residentBytes -= e.bytes;
+        --stats_.resident;
+        e.bytes = 0;
+        e.planner.reset();
+        lru_.erase(e.lru);
+    }
+    void trim(std::size_t scan) {
+        scan = std::min(scan, lru_.size());
+        for (std::size_t scanned = 0; stats_.residentBytes > budget_ && scanned < scan; ++scanned) {
+            Entry& e = *lru_.back();
+            if (e.dirty() || e.planner.use_count() > 1) {
+                lru_.splice(lru_.begin(), lru_, e.lru);
+                continue;
+            }
+            drop(e);
+            ++stats_.evictions;
+        }
+    }
+public:
+    // With no (or an empty) directory the store starts with `shards` empty shards.
+    explicit LazyPlannerStore(std::string directory, std::size_t memoryBudget = std::size_t(256) << 20,
+                              unsigned shards = 1)
+        : directory_(std::move(directory)), budget_(memoryBudget) {
+        if (!directory_.empty() && std::filesystem::is_directory(directory_)) open();
+        if (shards_.empty()) {
+            shards_.resize(std::max(1u, shards));
+            for (auto& sh : shards_) sh.indexed = true;
+        }
+    }
+    LazyPlannerStore(const LazyPlannerStore&) = delete;
+    LazyPlannerStore& operator=(const LazyPlannerStore&) = delete;
+    std::size_t studentCount() const { return students_; }
+    unsigned shardCount() const { return static_cast<unsigned>(shards_.size()); }
+    std::size_t memoryBudget() const { return budget_; }
+    void setMemoryBudget(std::size_t bytes) {
+        budget_ = bytes;
+        trim(lru_.size());
+    }
+    const Stats& stats() const { return stats_; }
+    // Whether save() would write anything new. Planners with changes are never
+    // evicted, so only the resident ones are looked at.
+    bool modified() const {
+        return removed_ || std::any_of(lru_.begin(), lru_.end(), [](const Entry* e) { return e->dirty(); });
+    }
+    bool contains(std::string_view id) {
+        Shard& sh = shardFor(id);
+        return sh.entries.find(id) != sh.entries.end();
+    }
+    // The student's planner, hydrated if need be. It stays resident while the
+    // caller holds it.
+    std::shared_ptr<StudyPlanner> planner(std::string_view id) {
+        Shard& sh = shardFor(id);
+        auto it = sh.entries.find(id);
+        if (it == sh.entries.end()) throw std::runtime_error("Student not found: " + std::string(id));
+        return hydrate(it->second, it->first);
+    }
+    std::shared_ptr<StudyPlanner> addStudent(std::string id, StudyPlanner planner = {}) {
+        Shard& sh = shardFor(id);
+        auto [it, fresh] = sh.entries.try_emplace(std::move(id));
+        if (!fresh) throw std::runtime_error("Student already exists: " + it->first);
+        Entry& e = it->second;
+        e.planner = std::make_shared<StudyPlanner>(std::move(planner));
+        e.unsaved = true;
+        e.lru = lru_.insert(lru_.begin(), &e);
+        ++stats_.resident;
+        ++students_;
+        return hydrate(e, it->first);
+    }
+    bool removeStudent(std::string_view id) {
+        Shard& sh = shardFor(id);
+        auto it = sh.entries.find(id);
+        if (it == sh.entries.end()) return false;
+        if (it->second.planner) drop(it->second);
+        sh.entries.erase(it);
+        --students_;
+        removed_ = true;
+        return true;
+    }
+    // Writes every shard as a new generation (shards never looked at are copied
+    // record by record), remaps it and removes the older generations.
+    void save() {
+        if (directory_.empty()) throw std::runtime_error("Lazy store has no directory");
+        std::filesystem::create_directories(directory_);
+        const std::uint64_t generation = generation_ + 1;
+        const unsigned count = shardCount();
+        std::vector<std::string> paths;
+        std::vector<std::vector<std::pair<Entry*, std::pair<std::uint64_t, std::uint64_t>>>> placed(count);
+        for (unsigned i = 0; i < count; ++i) {
+            Shard& sh = shards_[i];
+            paths.push_back(ShardedPlannerStore::shardFileName(directory_, generation, i, count));
+            if (!sh.indexed) {
+                ShardedPlannerStore::writeShardFile(paths[i], sh.students, generation, i, count, [&](auto&& record) {
+                    ShardedPlannerStore::forEachShardRecord(sh.file.data(), sh.file.size(), sh.path,
+                                                            [&](std::string_view id, std::span<const char> snapshot) {
+                        record(id, [&](std::ostream& os) { os.write(snapshot.data(), static_cast<std::streamsize>(snapshot.size())); });
+                    });
+                });
+                continue;
+            }
+            placed[i].reserve(sh.entries.size());
+            ShardedPlannerStore::writeShardFile(paths[i], sh.entries.size(), generation, i, count, [&](auto&& record) {
+                for (auto& [id, e] : sh.entries) {
+                    placed[i].emplace_back(&e, record(id, [&](std::ostream& os) {
+                        if (!e.planner) {
+                            os.write(e.snapshot.data(), static_cast<std::streamsize>(e.snapshot.size()));
+                            return;
+                        }
+                        const StudyPlanner& p = *e.planner;
+                        writeSnapshot(os, p.toStore(), p.getTotalDailyHours(), p.currentDay(), p.allocationMode());
+                    }));
+                }
+            });
+        }
+        for (unsigned i = 0; i < count; ++i) {
+            Shard& sh = shards_[i];
+            sh.file = MappedFile(paths[i]);
+            sh.path = std::move(paths[i]);
+            if (!sh.indexed) continue;
+            sh.students = sh.entries.size();
+            for (auto& [e, at] : placed[i]) {
+                e->snapshot = std::span<const char>(sh.file.data() + at.first, at.second);
+                e->unsaved = false;
+                if (e->planner) e->savedVersion = e->planner->version();
+            }
+        }
+        generation_ = generation;
+        removed_ = false;
+        for (const auto& entry : std::filesystem::directory_iterator(directory_)) {
+            std::uint64_t g;
+            unsigned idx, n;
+            if (ShardedPlannerStore::parseShardFileName(entry.path().filename().string(), g, idx, n) && g < generation)
+                std::filesystem::remove(entry.path());
+        }
+        trim(lru_.size());
     }
 };
 void printHeader() { std::cout << "\n=== SMART STUDY PLANNER (AI Scheduling) ===\n"; }
@@ -229,6 +5052,11 @@ void printMenu() {
               << "8) Adaptive Adjustment\n"
               << "9) Save to file\n"
               << "10) Load from file\n"
+              << "11) Save binary snapshot\n"
+              << "12) Load binary snapshot\n"
+              << "13) Set exam day for Subject\n"
+              << "14) Set current day\n"
+              << "15) Choose allocation mode\n"
               << "0) Exit\n"
               << "Enter choice: ";
 }
@@ -236,20 +5064,877 @@ int getInt(const std::string& prompt, int minv, int maxv) {
     while (true) {
         std::cout << prompt; int v;
         if (!(std::cin >> v)) { std::cin.clear(); std::cin.ignore(10000, '\n'); continue; }
-        if (v < minv || v > maxv) continue; return v;
+        if (v < minv || v > maxv) continue;
+        return v;
     }
 }
 double getDouble(const std::string& prompt, double minv, double maxv) {
     while (true) {
         std::cout << prompt; double v;
         if (!(std::cin >> v)) { std::cin.clear(); std::cin.ignore(10000, '\n'); continue; }
-        if (v < minv || v > maxv) continue; return v;
+        if (v < minv || v > maxv) continue;
+        return v;
     }
 }
 std::string getLineAfterPrompt(const std::string& prompt) {
     std::cout << prompt; std::string tmp; std::getline(std::cin, tmp); if (tmp.empty()) std::getline(std::cin, tmp); return tmp;
 }
-int main() {
+// Headless mode (--batch): runs one command per line against a planner and
+// writes the results to a single NDJSON or CSV stream. Fields are separated
+// by commas; blank lines and lines starting with '#' are skipped. Commands:
+//   add,<name>,<difficulty>,<importance>[,<perf>]   remove,<name>
+//   record,<name>,<score>[,<score>...]              hours,<total>
+//   due,<name>,<day>   day,<n>   mode,proportional|deadline
+//   generate   adjust[,<low>,<high>,<boost>,<reduce>]   schedule   subjects
+//   load,<csv>   save,<csv>   snapshot-load,<file>   snapshot-save,<file>
+// Only generate/adjust/schedule/subjects/load/snapshot-load and failures
+// produce output. Line numbers run on across all inputs.
+enum class OutputFormat { Ndjson, Csv };
+class ScriptRunner {
+public:
+    ScriptRunner(StudyPlanner& planner, OutputFormat format, std::FILE* out)
+        : planner_(&planner), format_(format), out_(out) {
+        if (format_ == OutputFormat::Csv) buf_ = "line,command,status,subject,difficulty,importance,perfScore,hours,dueDay,message\n";
+    }
+    // Service mode: NDJSON kept in output() for the caller to send, one reply
+    // per request (commands without output answer "ok"). use,<id> switches to
+    // planners(id, false), which must exist, and create,<id> to planners(id,
+    // true), which must not. Starts on planners("default", false). Requests come from the
+    // network, so the file commands only take relative paths inside fileRoot
+    // (and are refused when it is empty).
+    explicit ScriptRunner(std::function<StudyPlanner&(std::string_view, bool)> planners,
+                          std::filesystem::path fileRoot = {})
+        : planners_(std::move(planners)), planner_(&planners_("default", false)), format_(OutputFormat::Ndjson), out_(nullptr),
+          fileRoot_(std::move(fileRoot)) {}
+    ScriptRunner(const ScriptRunner&) = delete;
+    ScriptRunner& operator=(const ScriptRunner&) = delete;
+    ~ScriptRunner() { flush(); }
+    void runFile(std::FILE* in, const std::string& what) {
+        forEachLine(in, what, [&](std::string_view line) { run(line); });
+    }
+    // Executes one line; failures become error records and do not stop the run.
+    void run(std::string_view line) {
+        ++lineNo_;
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        line = trimField(line);
+        if (line.empty() || line.front() == '#') return;
+        fields_.clear();
+        while (true) {
+            std::size_t comma = line.find(',');
+            fields_.push_back(trimField(line.substr(0, comma)));
+            if (comma == std::string_view::npos) break;
+            line.remove_prefix(comma + 1);
+        }
+        try {
+            execute();
+        } catch (const std::exception& ex) {
+            ++errors_;
+            if (format_ == OutputFormat::Ndjson) {
+                beginRecord();
+                buf_ += ",\"error\":";
+                appendJson(ex.what());
+                buf_ += "}\n";
+            } else {
+                csvRow("error", nullptr, ex.what());
+            }
+        }
+        if (buf_.size() >= kFlushBytes) flush();
+    }
+    // Runs complete lines in order. A run of record lines is applied as one
+    // recordPerformanceBatch; if any of them would fail, nothing is applied and
+    // the run is replayed line by line so each failure is reported.
+    void runLines(std::span<const std::string_view> lines) {
+        for (std::size_t i = 0; i < lines.size();) {
+            updates_.clear();
+            std::size_t end = i;
+            while (end < lines.size() && parseRecord(lines[end])) ++end;
+            if (end - i >= 2 && planner_->recordPerformanceBatch(updates_).ok()) {
+                for (; i < end; ++i) {
+                    ++lineNo_;
+                    buf_ += "{\"line\":";
+                    appendNumber(lineNo_);
+                    buf_ += ",\"command\":\"record\",\"ok\":true}\n";
+                }
+            } else {
+                for (end = std::max(end, i + 1); i < end; ++i) run(lines[i]);
+            }
+        }
+    }
+    // An error record for input that is not a command (e.g. an overlong line).
+    void reject(std::string_view message) {
+        ++lineNo_;
+        ++errors_;
+        buf_ += "{\"line\":";
+        appendNumber(lineNo_);
+        buf_ += ",\"error\":";
+        appendJson(message);
+        buf_ += "}\n";
+    }
+    std::size_t errors() const { return errors_; }
+    std::string& output() { return buf_; }
+    void flush() {
+        if (!buf_.empty() && out_) {
+            std::fwrite(buf_.data(), 1, buf_.size(), out_);
+            buf_.clear();
+        }
+    }
+private:
+    static constexpr std::size_t kFlushBytes = std::size_t(1) << 16;
+    std::function<StudyPlanner&(std::string_view, bool)> planners_;
+    StudyPlanner* planner_;
+    OutputFormat format_;
+    std::FILE* out_;
+    std::filesystem::path fileRoot_;
+    std::string buf_;
+    std::vector<std::string_view> fields_;
+    std::vector<double> scores_;
+    std::vector<ScoreUpdate> updates_;
+    std::vector<double> scratch_;
+    std::size_t lineNo_ = 0;
+    std::size_t errors_ = 0;
+
+    // Appends the scores of a well-formed record line to updates_.
+    bool parseRecord(std::string_view line) {
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        line = trimField(line);
+        std::size_t comma = line.find(',');
+        if (comma == std::string_view::npos || trimField(line.substr(0, comma)) != "record") return false;
+        line.remove_prefix(comma + 1);
+        comma = line.find(',');
+        if (comma == std::string_view::npos) return false;
+        const std::string_view name = trimField(line.substr(0, comma));
+        const std::size_t mark = updates_.size();
+        do {
+            line.remove_prefix(comma + 1);
+            comma = line.find(',');
+            double v;
+            if (!parseField(trimField(line.substr(0, comma)), v)) {
+                updates_.resize(mark);
+                return false;
+            }
+            updates_.push_back({name, v});
+        } while (comma != std::string_view::npos);
+        return true;
+    }
+    // The file named by field i: as given in a script; in service mode a
+    // relative path without ".." under fileRoot_ (created for writes).
+    std::string filePath(std::size_t i, bool write) const {
+        if (!planners_) return std::string(fields_[i]);
+        if (fileRoot_.empty()) throw std::runtime_error("File commands are disabled in service mode");
+        const std::filesystem::path rel{std::string(fields_[i])};
+        bool inside = !rel.empty() && rel.is_relative() && !rel.has_root_name();
+        for (const auto& part : rel) inside = inside && part != "..";
+        if (!inside) throw std::runtime_error("File path must be relative to the server's file directory: " + std::string(fields_[i]));
+        const std::filesystem::path full = fileRoot_ / rel;
+        if (write) std::filesystem::create_directories(full.parent_path());
+        return full.string();
+    }
+    void expectFields(std::size_t min, std::size_t max) const {
+        if (fields_.size() < min || fields_.size() > max)
+            throw std::runtime_error("Wrong number of fields for " + std::string(fields_[0]));
+    }
+    template <typename T>
+    T number(std::size_t i) const {
+        T v{};
+        if (!parseField(fields_[i], v)) throw std::runtime_error("Invalid number: " + std::string(fields_[i]));
+        return v;
+    }
+    void execute() {
+        const std::string_view cmd = fields_[0];
+        const std::size_t before = buf_.size();
+        if ((cmd == "use" || cmd == "create") && planners_) {
+            expectFields(2, 2);
+            planner_ = &planners_(fields_[1], cmd == "create");
+        } else if (cmd == "add") {
+            expectFields(4, 5);
+            planner_->addSubject(std::string(fields_[1]), number<int>(2), number<int>(3),
+                                fields_.size() == 5 ? number<double>(4) : 100.0);
+        } else if (cmd == "remove") {
+            expectFields(2, 2);
+            planner_->removeSubject(fields_[1]);
+        } else if (cmd == "record") {
+            expectFields(3, std::numeric_limits<std::size_t>::max());
+            scores_.clear();
+            for (std::size_t i = 2; i < fields_.size(); ++i) scores_.push_back(number<double>(i));
+            planner_->recordPerformances(fields_[1], scores_, false);
+        } else if (cmd == "hours") {
+            expectFields(2, 2);
+            planner_->setTotalDailyHours(number<double>(1));
+        } else if (cmd == "due") {
+            expectFields(3, 3);
+            planner_->setDueDay(fields_[1], number<int>(2));
+        } else if (cmd == "day") {
+            expectFields(2, 2);
+            planner_->setCurrentDay(number<int>(1));
+        } else if (cmd == "mode") {
+            expectFields(2, 2);
+            if (fields_[1] == "proportional") planner_->setAllocationMode(AllocationMode::Proportional);
+            else if (fields_[1] == "deadline") planner_->setAllocationMode(AllocationMode::Deadline);
+            else throw std::runtime_error("Unknown allocation mode: " + std::string(fields_[1]));
+        } else if (cmd == "generate") {
+            expectFields(1, 1);
+            planner_->replan();
+            emitSchedule();
+        } else if (cmd == "adjust") {
+            if (fields_.size() != 1) expectFields(5, 5);
+            AdjustParams params;
+            if (fields_.size() == 5)
+                params = {number<double>(1), number<double>(2), number<double>(3), number<double>(4)};
+            planner_->adaptiveAdjust(scratch_, params);
+            emitSchedule();
+        } else if (cmd == "schedule") {
+            expectFields(1, 1);
+            emitSchedule();
+        } else if (cmd == "subjects") {
+            expectFields(1, 1);
+            emitSubjects();
+        } else if (cmd == "load") {
+            expectFields(2, 2);
+            emitImport(planner_->importCSV(filePath(1, false)));
+        } else if (cmd == "save") {
+            expectFields(2, 2);
+            planner_->saveToFile(filePath(1, true));
+        } else if (cmd == "snapshot-load") {
+            expectFields(2, 2);
+            planner_->loadSnapshot(filePath(1, false));
+            CsvImportReport report;
+            report.rows = report.imported = planner_->subjectCount();
+            emitImport(report);
+        } else if (cmd == "snapshot-save") {
+            expectFields(2, 2);
+            planner_->saveSnapshot(filePath(1, true));
+        } else {
+            throw std::runtime_error("Unknown command: " + std::string(cmd));
+        }
+        if (planners_ && buf_.size() == before) {
+            beginRecord();
+            buf_ += ",\"ok\":true}\n";
+        }
+    }
+    // JSON has no NaN or infinity; the planner rejects both, so null only marks
+    // a value that should never be there.
+    void appendNumber(double v) {
+        if (!std::isfinite(v)) {
+            buf_ += "null";
+            return;
+        }
+        char tmp[32];
+        buf_.append(tmp, std::to_chars(tmp, tmp + sizeof tmp, v).ptr);
+    }
+    void appendNumber(std::size_t v) {
+        char tmp[24];
+        buf_.append(tmp, std::to_chars(tmp, tmp + sizeof tmp, v).ptr);
+    }
+    void appendNumber(int v) {
+        char tmp[16];
+        buf_.append(tmp, std::to_chars(tmp, tmp + sizeof tmp, v).ptr);
+    }
+    void appendJson(std::string_view s) {
+        buf_ += '"';
+        for (char c : s) {
+            if (c == '"' || c == '\\') {
+                buf_ += '\\';
+                buf_ += c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                char tmp[8];
+                std::snprintf(tmp, sizeof tmp, "\\u%04x", static_cast<unsigned>(c));
+                buf_ += tmp;
+            } else {
+                buf_ += c;
+            }
+        }
+        buf_ += '"';
+    }
+    void appendCsv(std::string_view s) {
+        if (s.find_first_of(",\"\n\r") == std::string_view::npos) {
+            buf_ += s;
+            return;
+        }
+        buf_ += '"';
+        for (char c : s) {
+            if (c == '"') buf_ += '"';
+            buf_ += c;
+        }
+        buf_ += '"';
+    }
+    // {"line":N,"command":"..." -- the caller adds the rest and the closing brace.
+    void beginRecord() {
+        buf_ += "{\"line\":";
+        appendNumber(lineNo_);
+        buf_ += ",\"command\":";
+        appendJson(fields_[0]);
+    }
+    // One CSV row; subject may be null, message may be empty.
+    void csvRow(const char* status, const Subject* subject, std::string_view message = {}) {
+        appendNumber(lineNo_);
+        buf_ += ',';
+        appendCsv(fields_[0]);
+        buf_ += ',';
+        buf_ += status;
+        buf_ += ',';
+        if (subject) {
+            appendCsv(subject->nameView());
+            buf_ += ',';
+            appendNumber(subject->difficulty());
+            buf_ += ',';
+            appendNumber(subject->importance());
+            buf_ += ',';
+            appendNumber(subject->perfScore());
+            buf_ += ',';
+            appendNumber(subject->allocatedHours());
+            buf_ += ',';
+            if (subject->hasDueDay()) appendNumber(subject->dueDay());
+            buf_ += ',';
+        } else {
+            buf_ += ",,,,,,";
+        }
+        appendCsv(message);
+        buf_ += '\n';
+    }
+    void emitSchedule() {
+        if (format_ == OutputFormat::Csv) {
+            planner_->forEachSubject([&](std::size_t, const Subject& s) { csvRow("ok", &s); });
+            return;
+        }
+        beginRecord();
+        buf_ += ",\"totalHours\":";
+        appendNumber(planner_->getTotalDailyHours());
+        buf_ += ",\"schedule\":[";
+        planner_->forEachSubject([&](std::size_t i, const Subject& s) {
+            buf_ += i ? ",{\"subject\":" : "{\"subject\":";
+            appendJson(s.nameView());
+            buf_ += ",\"hours\":";
+            appendNumber(s.allocatedHours());
+            buf_ += '}';
+        });
+        buf_ += "]}\n";
+    }
+    void emitSubjects() {
+        if (format_ == OutputFormat::Csv) {
+            planner_->forEachSubject([&](std::size_t, const Subject& s) { csvRow("ok", &s); });
+            return;
+        }
+        beginRecord();
+        buf_ += ",\"subjects\":[";
+        planner_->forEachSubject([&](std::size_t i, const Subject& s) {
+            buf_ += i ? ",{\"name\":" : "{\"name\":";
+            appendJson(s.nameView());
+            buf_ += ",\"difficulty\":";
+            appendNumber(s.difficulty());
+            buf_ += ",\"importance\":";
+            appendNumber(s.importance());
+            buf_ += ",\"perfScore\":";
+            appendNumber(s.perfScore());
+            buf_ += ",\"hours\":";
+            appendNumber(s.allocatedHours());
+            buf_ += ",\"dueDay\":";
+            if (s.hasDueDay()) appendNumber(s.dueDay());
+            else buf_ += "null";
+            buf_ += '}';
+        });
+        buf_ += "]}\n";
+    }
+    void emitImport(const CsvImportReport& report) {
+        if (format_ == OutputFormat::Csv) {
+            csvRow("ok", nullptr, "imported " + std::to_string(report.imported) + ", rejected " +
+                                      std::to_string(report.rejected));
+            for (const auto& e : report.errors)
+                csvRow("rejected", nullptr, "line " + std::to_string(e.line) + ": " + e.message);
+            return;
+        }
+        beginRecord();
+        buf_ += ",\"imported\":";
+        appendNumber(report.imported);
+        buf_ += ",\"rejected\":";
+        appendNumber(report.rejected);
+        buf_ += ",\"errors\":[";
+        for (std::size_t i = 0; i < report.errors.size(); ++i) {
+            buf_ += i ? ",{\"line\":" : "{\"line\":";
+            appendNumber(report.errors[i].line);
+            buf_ += ",\"message\":";
+            appendJson(report.errors[i].message);
+            buf_ += '}';
+        }
+        buf_ += "]}\n";
+    }
+};
+#if defined(SSP_HAVE_SOCKETS)
+// Service mode (--serve): keeps planners resident and answers the --batch
+// command language over TCP. Every non-blank request line gets exactly one
+// NDJSON reply line, in order, whose "line" is the request's number on that
+// connection, so clients can pipeline freely. use,<id> picks an existing
+// planner and create,<id> adds an empty one for the connection's next
+// requests; each connection starts on "default", which the server creates if
+// need be. Planners live in a LazyPlannerStore, so a store directory opens at
+// once and only the planners in use are hydrated; a connection holds its
+// current planner resident. With a store, run() can also checkpoint it at a
+// fixed interval. Subject names are interned for the life of the process (see
+// NameInterner), so each distinct name clients add stays in memory until the
+// server restarts. One thread runs a poll()
+// loop, so planners need no locks. All complete lines read from a connection in one pass run
+// together (runs of record lines as one batch) before the replies are sent.
+class PlannerServer {
+private:
+    static constexpr std::size_t kReadChunk = std::size_t(1) << 16;
+    static constexpr std::size_t kMaxLine = std::size_t(1) << 20;     // unterminated request bytes
+    static constexpr std::size_t kMaxPending = std::size_t(4) << 20;  // unsent replies before reads pause
+    struct Connection {
+        int fd;
+        std::string in;
+        std::size_t sent = 0;
+        bool closing = false;   // peer finished sending: drain replies, then close
+        std::shared_ptr<StudyPlanner> current;
+        ScriptRunner runner;
+        Connection(int fd, PlannerServer& server)
+            : fd(fd),
+              runner([this, &server](std::string_view id, bool create) -> StudyPlanner& {
+                  return *(current = create ? server.createPlanner(id) : server.planner(id));
+              }, server.fileRoot_) {}
+        ~Connection() { ::close(fd); }
+        std::size_t pending() { return runner.output().size() - sent; }
+    };
+    LazyPlannerStore store_;
+    std::filesystem::path fileRoot_;   // files/ in the store directory; none without a store
+    std::vector<std::unique_ptr<Connection>> connections_;
+    std::vector<std::string_view> lines_;
+    int listen_ = -1;
+    int wake_[2] = {-1, -1};
+    std::uint16_t port_ = 0;
+    static void nonBlocking(int fd) { ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK); }
+    void acceptAll() {
+        while (true) {
+            const int fd = ::accept(listen_, nullptr, nullptr);
+            if (fd < 0) return;
+            nonBlocking(fd);
+            const int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+            connections_.push_back(std::make_unique<Connection>(fd, *this));
+        }
+    }
+    // Reads until a complete line (or kMaxLine bytes) is buffered, then runs
+    // the complete lines; false on a dead peer. Anything further stays in the
+    // socket for the next poll, so c.in is bounded by kMaxLine + kReadChunk.
+    bool readFrom(Connection& c) {
+        char chunk[kReadChunk];
+        while (c.in.size() < kMaxLine) {
+            const ssize_t n = ::recv(c.fd, chunk, sizeof chunk, 0);
+            if (n > 0) {
+                c.in.append(chunk, static_cast<std::size_t>(n));
+                if (std::memchr(chunk, '\n', static_cast<std::size_t>(n))) break;
+                continue;
+            }
+            if (n == 0) c.closing = true;
+            else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) return false;
+            break;
+        }
+        const std::size_t last = c.in.rfind('\n');
+        if (last != std::string::npos) {
+            lines_.clear();
+            std::string_view block(c.in.data(), last + 1);
+            while (!block.empty()) {
+                const std::size_t nl = block.find('\n');
+                lines_.push_back(block.substr(0, nl));
+                block.remove_prefix(nl + 1);
+            }
+            c.runner.runLines(lines_);
+            c.in.erase(0, last + 1);
+        }
+        if (c.in.size() >= kMaxLine) {
+            c.runner.reject("Request line too long");
+            c.in.clear();
+            c.closing = true;
+        }
+        if (c.closing && !c.in.empty()) {
+            c.runner.run(c.in);
+            c.in.clear();
+        }
+        return true;
+    }
+    // Sends queued replies; false once the connection should be dropped.
+    bool writeTo(Connection& c) {
+        std::string& out = c.runner.output();
+        while (c.sent < out.size()) {
+            const ssize_t n = ::send(c.fd, out.data() + c.sent, out.size() - c.sent, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) break;
+                return false;
+            }
+            c.sent += static_cast<std::size_t>(n);
+        }
+        if (c.sent == out.size()) {
+            out.clear();
+            c.sent = 0;
+        } else if (c.sent > out.size() / 2) {
+            out.erase(0, c.sent);
+            c.sent = 0;
+        }
+        return !(c.closing && out.empty());
+    }
+public:
+    // Binds and listens on host:port (port 0 picks a free port); planners are
+    // kept in memory only unless a store directory is given. Clients' load and
+    // save commands are confined to its files/ subdirectory, and refused
+    // without a store.
+    PlannerServer(const std::string& host, std::uint16_t port, std::string storeDirectory = {},
+                  std::size_t memoryBudget = std::size_t(256) << 20)
+        : store_(storeDirectory, memoryBudget),
+          fileRoot_(storeDirectory.empty() ? std::filesystem::path() : std::filesystem::path(storeDirectory) / "files") {
+        if (!store_.contains("default")) store_.addStudent("default");
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        if (::inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) throw std::runtime_error("Invalid listen address: " + host);
+        listen_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (listen_ < 0) throw std::runtime_error("Unable to create socket");
+        const int one = 1;
+        ::setsockopt(listen_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+        socklen_t len = sizeof addr;
+        if (::bind(listen_, reinterpret_cast<sockaddr*>(&addr), sizeof addr) != 0 || ::listen(listen_, SOMAXCONN) != 0 ||
+            ::getsockname(listen_, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+            ::close(listen_);
+            throw std::runtime_error("Unable to listen on " + host + ":" + std::to_string(port));
+        }
+        port_ = ntohs(addr.sin_port);
+        nonBlocking(listen_);
+        if (::pipe(wake_) != 0) {
+            ::close(listen_);
+            throw std::runtime_error("Unable to create wake pipe");
+        }
+        nonBlocking(wake_[0]);
+        nonBlocking(wake_[1]);
+    }
+    PlannerServer(const PlannerServer&) = delete;
+    PlannerServer& operator=(const PlannerServer&) = delete;
+    ~PlannerServer() {
+        connections_.clear();
+        for (int fd : {listen_, wake_[0], wake_[1]}) ::close(fd);
+    }
+    std::uint16_t port() const { return port_; }
+    std::shared_ptr<StudyPlanner> planner(std::string_view id) { return store_.planner(id); }
+    std::shared_ptr<StudyPlanner> createPlanner(std::string_view id) { return store_.addStudent(std::string(id)); }
+    LazyPlannerStore& store() { return store_; }
+    // Saves the store if it has one and anything changed since the last save.
+    // A failed save is reported and retried at the next checkpoint, so the
+    // server keeps answering.
+    void checkpoint() {
+        if (fileRoot_.empty() || !store_.modified()) return;
+        try {
+            store_.save();
+        } catch (const std::exception& ex) {
+            std::cerr << "Error: checkpoint failed: " << ex.what() << "\n";
+        }
+    }
+    std::size_t connectionCount() const { return connections_.size(); }
+    // Makes run() return; safe to call from a signal handler or another thread.
+    void stop() {
+        const char b = 0;
+        [[maybe_unused]] ssize_t n = ::write(wake_[1], &b, 1);
+    }
+    // Serves until stop(); with a nonzero interval, calls checkpoint() that
+    // often.
+    void run(std::chrono::milliseconds checkpointInterval = std::chrono::milliseconds::zero()) {
+        using Clock = std::chrono::steady_clock;
+        std::vector<pollfd> fds;
+        auto nextCheckpoint = Clock::now() + checkpointInterval;
+        while (true) {
+            int timeout = -1;
+            if (checkpointInterval.count() > 0) {
+                auto now = Clock::now();
+                if (now >= nextCheckpoint) {
+                    checkpoint();
+                    now = Clock::now();
+                    nextCheckpoint = now + checkpointInterval;
+                }
+                timeout = static_cast<int>(std::min<std::chrono::milliseconds::rep>(
+                    std::chrono::ceil<std::chrono::milliseconds>(nextCheckpoint - now).count(), std::numeric_limits<int>::max()));
+            }
+            fds.assign({{wake_[0], POLLIN, 0}, {listen_, POLLIN, 0}});
+            for (const auto& c : connections_) {
+                short events = c->pending() ? POLLOUT : 0;
+                if (!c->closing && c->pending() < kMaxPending) events |= POLLIN;
+                fds.push_back({c->fd, events, 0});
+            }
+            if (::poll(fds.data(), fds.size(), timeout) < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error("poll failed");
+            }
+            if (fds[0].revents) return;
+            if (fds[1].revents & POLLIN) acceptAll();
+            std::size_t keep = 0;
+            for (std::size_t i = 0; i < connections_.size(); ++i) {
+                auto& c = *connections_[i];
+                const short ev = i + 2 < fds.size() ? fds[i + 2].revents : 0;
+                bool alive = true;
+                if (ev & (POLLIN | POLLHUP | POLLERR)) alive = readFrom(c);
+                if (alive && (c.pending() || c.closing)) alive = writeTo(c);
+                if (alive) connections_[keep++] = std::move(connections_[i]);
+            }
+            connections_.resize(keep);
+        }
+    }
+};
+#endif
+// --batch [--format=ndjson|csv] [--subjects=<csv>]... [script|-]...
+// Scripts run in order against one planner (no sample subjects); with no
+// script, commands come from stdin. Each --subjects file is a leading load
+// command. Output goes through one fully buffered stdout. Exits 1 if any
+// command failed.
+int runScript(int argc, char** argv) {
+    OutputFormat format = OutputFormat::Ndjson;
+    std::vector<std::string> preload, scripts;
+    for (int i = 2; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--format=ndjson") format = OutputFormat::Ndjson;
+        else if (arg == "--format=csv") format = OutputFormat::Csv;
+        else if (arg.substr(0, 11) == "--subjects=") preload.emplace_back(arg.substr(11));
+        else scripts.emplace_back(arg);
+    }
+    if (scripts.empty()) scripts.emplace_back("-");
+    static char outBuf[1 << 16];
+    std::setvbuf(stdout, outBuf, _IOFBF, sizeof outBuf);
+    StudyPlanner planner;
+    ScriptRunner runner(planner, format, stdout);
+    for (const auto& file : preload) runner.run("load," + file);
+    for (const auto& script : scripts) {
+        if (script == "-") {
+            runner.runFile(stdin, "stdin");
+            continue;
+        }
+        std::unique_ptr<std::FILE, int (*)(std::FILE*)> in(std::fopen(script.c_str(), "rb"), &std::fclose);
+        if (!in) {
+            runner.flush();
+            std::fflush(stdout);
+            std::cerr << "Error: Unable to open file for reading: " << script << "\n";
+            return 2;
+        }
+        runner.runFile(in.get(), script);
+    }
+    runner.flush();
+    std::fflush(stdout);
+    return runner.errors() ? 1 : 0;
+}
+#if defined(SSP_HAVE_SOCKETS)
+PlannerServer* activeServer = nullptr;
+// --serve [--host=<ipv4>] [--port=<n>] [--store=<dir>] [--memory-budget=<MiB>]
+//         [--checkpoint=<seconds>] [--subjects=<csv>]...
+// Serves until SIGINT or SIGTERM; each --subjects file is loaded into the
+// "default" planner first. Prints the bound address (useful with --port=0).
+// With --store the planners are served from that sharded store directory,
+// saved back to it every --checkpoint seconds (60; 0 turns it off) when
+// anything changed and again on shutdown, and clients' load/save/snapshot-*
+// paths are relative to its files/ subdirectory; without it those commands fail.
+int runServer(int argc, char** argv) {
+    std::string host = "127.0.0.1", store;
+    std::uint16_t port = 7878;
+    std::size_t budgetMiB = 256;
+    unsigned long checkpointSeconds = 60;
+    std::vector<std::string> preload;
+    for (int i = 2; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg.substr(0, 7) == "--host=") host = arg.substr(7);
+        else if (arg.substr(0, 7) == "--port=") port = static_cast<std::uint16_t>(std::stoul(std::string(arg.substr(7))));
+        else if (arg.substr(0, 8) == "--store=") store = arg.substr(8);
+        else if (arg.substr(0, 16) == "--memory-budget=") budgetMiB = std::stoul(std::string(arg.substr(16)));
+        else if (arg.substr(0, 13) == "--checkpoint=") checkpointSeconds = std::stoul(std::string(arg.substr(13)));
+        else if (arg.substr(0, 11) == "--subjects=") preload.emplace_back(arg.substr(11));
+        else {
+            std::cerr << "Error: Unknown option: " << arg << "\n";
+            return 2;
+        }
+    }
+    try {
+        const auto opened = std::chrono::steady_clock::now();
+        PlannerServer server(host, port, store, budgetMiB << 20);
+        if (!store.empty())
+            std::cout << "opened " << store << ": " << server.store().studentCount() << " students in "
+                      << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - opened).count()
+                      << " ms" << std::endl;
+        for (const auto& file : preload) server.planner("default")->importCSV(file);
+        // The handlers go back to SIG_DFL before activeServer stops being
+        // valid, on the normal path and when unwinding.
+        struct SignalScope {
+            explicit SignalScope(PlannerServer& server) {
+                activeServer = &server;
+                auto onSignal = [](int) { activeServer->stop(); };
+                std::signal(SIGINT, onSignal);
+                std::signal(SIGTERM, onSignal);
+            }
+            ~SignalScope() { restore(); }
+            void restore() {
+                std::signal(SIGINT, SIG_DFL);
+                std::signal(SIGTERM, SIG_DFL);
+                activeServer = nullptr;
+            }
+        } signals(server);
+        std::cout << "listening on " << host << ":" << server.port() << std::endl;
+        server.run(store.empty() ? std::chrono::milliseconds::zero() : std::chrono::seconds(checkpointSeconds));
+        signals.restore();
+        if (!store.empty()) server.store().save();
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
+#endif
+// Compares the pointer-based StudyPlanner against the columnar SubjectStore on
+// synthetic subject sets. Reports the best of several runs in ns per subject.
+int runLayoutBenchmark(const std::vector<std::size_t>& sizes) {
+    using Clock = std::chrono::steady_clock;
+    std::cout << "allocation kernels: " << allocationKernels().isa << "\n";
+    std::cout << std::left << std::setw(10) << "subjects" << std::setw(22) << "pass"
+              << std::setw(14) << "ptr ns/subj" << std::setw(14) << "soa ns/subj" << "speedup\n";
+    for (std::size_t n : sizes) {
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<int> level(1, 10);
+        std::normal_distribution<double> score(75.0, 15.0);
+        StudyPlanner planner;
+        for (std::size_t i = 0; i < n; ++i)
+            planner.addSubject("S" + std::to_string(i), level(rng), level(rng), clamp(score(rng), 0.0, 100.0));
+        SubjectStore store = planner.toStore();
+        const int reps = static_cast<int>(std::max<std::size_t>(3, 10000000 / std::max<std::size_t>(n, 1)));
+        auto best = [&](const std::function<void()>& fn) {
+            double bestNs = 1e300;
+            for (int r = 0; r < std::min(reps, 50); ++r) {
+                auto t0 = Clock::now();
+                fn();
+                bestNs = std::min(bestNs, std::chrono::duration<double, std::nano>(Clock::now() - t0).count());
+            }
+            return bestNs / static_cast<double>(n);
+        };
+        auto report = [&](const char* pass, double ptrNs, double soaNs) {
+            std::cout << std::left << std::setw(10) << n << std::setw(22) << pass
+                      << std::setw(14) << fmtd(ptrNs) << std::setw(14) << fmtd(soaNs) << fmtd(ptrNs / soaNs) << "x\n";
+        };
+        report("generateSchedule", best([&] { planner.replan(); }),
+               best([&] { store.generateSchedule(planner.getTotalDailyHours()); }));
+        report("adaptiveAdjust", best([&] { planner.adaptiveAdjust(); }),
+               best([&] { store.adaptiveAdjust(planner.getTotalDailyHours()); }));
+    }
+    return 0;
+}
+// Times one nightly replan: every planner sequentially on one thread, then the
+// same planners through BatchScheduler, then the flat multi-tenant table.
+int runBatchBenchmark(std::size_t plannerCount, std::size_t subjectsPerPlanner, unsigned threads) {
+    using Clock = std::chrono::steady_clock;
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> level(1, 10);
+    std::normal_distribution<double> score(75.0, 15.0);
+    std::vector<StudyPlanner> planners(plannerCount);
+    SubjectStore table;
+    std::vector<std::size_t> offsets{0};
+    std::vector<double> dailyHours;
+    for (auto& p : planners) {
+        for (std::size_t i = 0; i < subjectsPerPlanner; ++i)
+            p.addSubject("S" + std::to_string(i), level(rng), level(rng), clamp(score(rng), 0.0, 100.0));
+        SubjectStore store = p.toStore();
+        for (std::size_t i = 0; i < store.size(); ++i) table.add(store.subjectAt(i));
+        offsets.push_back(table.size());
+        dailyHours.push_back(p.getTotalDailyHours());
+    }
+    auto secs = [](Clock::time_point t0) { return std::chrono::duration<double>(Clock::now() - t0).count(); };
+    auto t0 = Clock::now();
+    for (auto& p : planners) p.replan();
+    double sequential = secs(t0);
+    BatchScheduler batch(threads);
+    std::vector<PlannerResult> results;
+    batch.run(planners, BatchOptions{}, results);
+    t0 = Clock::now();
+    batch.run(planners, BatchOptions{}, results);
+    double parallel = secs(t0);
+    batch.run(table, offsets, dailyHours, BatchOptions{}, results);
+    t0 = Clock::now();
+    batch.run(table, offsets, dailyHours, BatchOptions{}, results);
+    double flat = secs(t0);
+    std::cout << plannerCount << " planners x " << subjectsPerPlanner << " subjects, "
+              << batch.threads() << " threads\n"
+              << "  sequential replan : " << fmtd(sequential * 1e3) << " ms\n"
+              << "  batch (planners)  : " << fmtd(parallel * 1e3) << " ms (" << fmtd(sequential / parallel) << "x)\n"
+              << "  batch (flat table): " << fmtd(flat * 1e3) << " ms (" << fmtd(sequential / flat) << "x)\n";
+    return 0;
+}
+// Times a grid search of adaptiveAdjust parameters over a synthetic cohort
+// (five subjects per student) and prints the best configurations.
+int runSimulationBenchmark(std::size_t students, std::size_t configs, std::size_t rounds, unsigned threads) {
+    using Clock = std::chrono::steady_clock;
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> level(1, 10);
+    std::normal_distribution<double> score(75.0, 15.0);
+    SubjectStore cohort;
+    std::vector<std::size_t> offsets{0};
+    for (std::size_t t = 0; t < students; ++t) {
+        for (int j = 0; j < 5; ++j) cohort.add("S" + std::to_string(j), level(rng), level(rng), clamp(score(rng), 0.0, 100.0));
+        offsets.push_back(cohort.size());
+    }
+    std::vector<double> scores(rounds * cohort.size());
+    for (double& s : scores) s = clamp(score(rng), 0.0, 100.0);
+    auto t0 = Clock::now();
+    AdjustSimulator sim(cohort, offsets, std::vector<double>(students, 4.0), scores, rounds, threads);
+    double replay = std::chrono::duration<double>(Clock::now() - t0).count();
+    std::size_t steps = 1;
+    while (steps * steps * steps * steps < configs) ++steps;
+    std::vector<double> low, high, boost, reduce;
+    for (std::size_t i = 0; i < steps; ++i) {
+        double f = steps > 1 ? static_cast<double>(i) / static_cast<double>(steps - 1) : 0.5;
+        low.push_back(50.0 + 25.0 * f);
+        high.push_back(80.0 + 15.0 * f);
+        boost.push_back(1.0 + 0.5 * f);
+        reduce.push_back(0.6 + 0.4 * f);
+    }
+    std::vector<AdjustParams> grid = AdjustSimulator::grid(low, high, boost, reduce);
+    grid.resize(std::min(grid.size(), configs));
+    t0 = Clock::now();
+    std::vector<AdjustOutcome> outcomes = sim.run(grid);
+    double search = std::chrono::duration<double>(Clock::now() - t0).count();
+    std::sort(outcomes.begin(), outcomes.end(),
+              [](const AdjustOutcome& a, const AdjustOutcome& b) { return a.gainPerHour > b.gainPerHour; });
+    std::cout << students << " students x " << rounds << " rounds x " << grid.size() << " configs, "
+              << threads << " threads\n"
+              << "  score replay: " << fmtd(replay * 1e3) << " ms\n"
+              << "  grid search : " << fmtd(search * 1e3) << " ms ("
+              << fmtd(static_cast<double>(grid.size() * cohort.size() * rounds) / search / 1e6) << "M subject-rounds/s)\n"
+              << "  low   high  boost reduce  weakShare churn   gainPerHour\n";
+    for (std::size_t i = 0; i < std::min<std::size_t>(5, outcomes.size()); ++i) {
+        const AdjustOutcome& o = outcomes[i];
+        std::cout << "  " << std::left << std::setw(6) << fmtd(o.params.lowThreshold, 1) << std::setw(6)
+                  << fmtd(o.params.highThreshold, 1) << std::setw(6) << fmtd(o.params.boostFactor) << std::setw(8)
+                  << fmtd(o.params.reduceFactor) << std::setw(10) << fmtd(o.weakShare, 4) << std::setw(8)
+                  << fmtd(o.churn, 4) << fmtd(o.gainPerHour, 4) << "\n";
+    }
+    return 0;
+}
+#ifndef SSP_NO_MAIN
+int main(int argc, char** argv) {
+#ifdef SSP_METRICS
+    struct MetricsDump {
+        ~MetricsDump() {
+            if (const char* path = std::getenv("SSP_METRICS_FILE")) std::ofstream(path) << prometheusMetrics();
+        }
+    } metricsDump;
+#endif
+    if (argc > 1 && std::string(argv[1]) == "--batch") return runScript(argc, argv);
+#if defined(SSP_HAVE_SOCKETS)
+    if (argc > 1 && std::string(argv[1]) == "--serve") return runServer(argc, argv);
+#endif
+    if (argc > 1 && std::string(argv[1]) == "--bench-layout") {
+        std::vector<std::size_t> sizes;
+        for (int i = 2; i < argc; ++i) sizes.push_back(std::stoul(argv[i]));
+        if (sizes.empty()) sizes = {1000, 100000, 10000000};
+        return runLayoutBenchmark(sizes);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-batch") {
+        std::size_t planners = argc > 2 ? std::stoul(argv[2]) : 100000;
+        std::size_t subjects = argc > 3 ? std::stoul(argv[3]) : 8;
+        unsigned threads = argc > 4 ? static_cast<unsigned>(std::stoul(argv[4])) : std::thread::hardware_concurrency();
+        return runBatchBenchmark(planners, subjects, threads);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--bench-simulate") {
+        std::size_t students = argc > 2 ? std::stoul(argv[2]) : 100000;
+        std::size_t configs = argc > 3 ? std::stoul(argv[3]) : 256;
+        std::size_t rounds = argc > 4 ? std::stoul(argv[4]) : 20;
+        unsigned threads = argc > 5 ? static_cast<unsigned>(std::stoul(argv[5])) : std::thread::hardware_concurrency();
+        return runSimulationBenchmark(students, configs, rounds, threads);
+    }
     StudyPlanner planner; printHeader();
     try {
         planner.addSubject("Math", 9, 10, 80.0);
@@ -296,8 +5981,24 @@ int main() {
             } else if (choice == 10) {
                 std::string fname = getLineAfterPrompt("Load filename: ");
                 planner.loadFromFile(fname);
+            } else if (choice == 11) {
+                std::string fname = getLineAfterPrompt("Snapshot filename: ");
+                planner.saveSnapshot(fname);
+            } else if (choice == 12) {
+                std::string fname = getLineAfterPrompt("Snapshot filename: ");
+                planner.loadSnapshot(fname);
+            } else if (choice == 13) {
+                std::string name = getLineAfterPrompt("Subject name: ");
+                int day = getInt("Exam day (-1 to clear): ", -1, 100000);
+                planner.setDueDay(name, day);
+            } else if (choice == 14) {
+                planner.setCurrentDay(getInt("Current day: ", 0, 100000));
+            } else if (choice == 15) {
+                int mode = getInt("1) Proportional  2) Deadline-aware: ", 1, 2);
+                planner.setAllocationMode(mode == 2 ? AllocationMode::Deadline : AllocationMode::Proportional);
             }
         } catch (const std::exception& ex) { std::cerr << "Error: " << ex.what() << "\n"; }
     }
     std::cout << "Goodbye!\n"; return 0;
 }
+#endif
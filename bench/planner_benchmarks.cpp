@@ -0,0 +1,308 @@
+// Google Benchmark suite for the planner hot paths. Build from the repo root:
+//
+//     g++ -std=c++20 -O2 -pthread -o planner_benchmarks bench/planner_benchmarks.cpp -lbenchmark
+//
+// Sizes run from 10 subjects up to SSP_BENCH_MAX_SUBJECTS (default 10M) in
+// steps of 10x. Use --benchmark_out=<file> --benchmark_out_format=json for
+// machine-readable results.
+#define SSP_NO_MAIN
+#include "../SmartStudyPlanner.cpp"
+
+#include <benchmark/benchmark.h>
+
+namespace {
+
+// Same synthetic population as --bench-layout: levels uniform in 1-10, scores
+// normal around 75 and clamped, so the bench numbers are comparable.
+StudyPlanner makePlanner(std::size_t n, unsigned seed = 42) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> level(1, 10);
+    std::normal_distribution<double> score(75.0, 15.0);
+    StudyPlanner planner;
+    for (std::size_t i = 0; i < n; ++i)
+        planner.addSubject("S" + std::to_string(i), level(rng), level(rng), clamp(score(rng), 0.0, 100.0));
+    return planner;
+}
+
+// A fixed stream of (subject, score) pairs drawn from the same distribution,
+// cycled by the update benchmarks so the RNG stays out of the timed loop.
+struct ScoreStream {
+    std::vector<std::string> names;
+    std::vector<double> scores;
+    ScoreStream(std::size_t subjects, std::size_t length = 1 << 16) {
+        std::mt19937 rng(7);
+        std::uniform_int_distribution<std::size_t> pick(0, subjects - 1);
+        std::normal_distribution<double> score(75.0, 15.0);
+        for (std::size_t i = 0; i < length; ++i) {
+            names.push_back("S" + std::to_string(pick(rng)));
+            scores.push_back(clamp(score(rng), 0.0, 100.0));
+        }
+    }
+};
+
+std::size_t maxSubjects() {
+    const char* env = std::getenv("SSP_BENCH_MAX_SUBJECTS");
+    return env ? std::max<std::size_t>(10, std::strtoull(env, nullptr, 10)) : 10000000;
+}
+
+void subjectSizes(benchmark::internal::Benchmark* b) {
+    for (std::size_t n = 10; n <= maxSubjects(); n *= 10) b->Arg(static_cast<int64_t>(n));
+}
+
+std::string benchFile(const char* tag) {
+    return (std::filesystem::temp_directory_path() / ("ssp-bench-" + std::string(tag) + ".csv")).string();
+}
+
+void BM_Replan(benchmark::State& state) {
+    const auto n = static_cast<std::size_t>(state.range(0));
+    StudyPlanner planner = makePlanner(n);
+    for (auto _ : state) {
+        planner.replan();
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Alternates the daily hours so each pass has a different content key from
+// the memoized one, and keeps the shared cache off (restoring its capacity
+// afterwards), so every pass replans.
+void BM_GenerateSchedule(benchmark::State& state) {
+    const auto n = static_cast<std::size_t>(state.range(0));
+    StudyPlanner planner = makePlanner(n);
+    ScheduleCache& cache = ScheduleCache::shared();
+    const std::size_t capacity = cache.capacity();
+    cache.setCapacity(0);
+    bool odd = false;
+    for (auto _ : state) {
+        planner.setTotalDailyHours((odd = !odd) ? 5.0 : 4.0);
+        benchmark::DoNotOptimize(planner.generateSchedule());
+    }
+    cache.setCapacity(capacity);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_CachedSchedule(benchmark::State& state) {
+    const auto n = static_cast<std::size_t>(state.range(0));
+    StudyPlanner planner = makePlanner(n);
+    for (auto _ : state) benchmark::DoNotOptimize(planner.cachedSchedule());
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_GenerateFlatSchedule(benchmark::State& state) {
+    const auto n = static_cast<std::size_t>(state.range(0));
+    StudyPlanner planner = makePlanner(n);
+    for (auto _ : state) benchmark::DoNotOptimize(planner.generateFlatSchedule());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_AdaptiveAdjust(benchmark::State& state) {
+    const auto n = static_cast<std::size_t>(state.range(0));
+    StudyPlanner planner = makePlanner(n);
+    planner.replan();
+    std::vector<double> scratch;
+    for (auto _ : state) {
+        // Rescaling compounds, so start every pass from the same plan.
+        state.PauseTiming();
+        planner.replan();
+        state.ResumeTiming();
+        benchmark::DoNotOptimize(planner.adaptiveAdjust(scratch, AdjustParams{}));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_RecordPerformance(benchmark::State& state) {
+    const auto n = static_cast<std::size_t>(state.range(0));
+    StudyPlanner planner = makePlanner(n);
+    ScoreStream stream(n);
+    std::size_t i = 0;
+    for (auto _ : state) {
+        planner.recordPerformance(stream.names[i], stream.scores[i]);
+        i = (i + 1) & (stream.names.size() - 1);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_RecordAndReplan(benchmark::State& state) {
+    const auto n = static_cast<std::size_t>(state.range(0));
+    StudyPlanner planner = makePlanner(n);
+    planner.replan();
+    ScoreStream stream(n);
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(planner.recordAndReplan(stream.names[i], stream.scores[i]));
+        i = (i + 1) & (stream.names.size() - 1);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Batches of 1024 scores, as the bulk API is meant to be fed.
+void BM_RecordPerformanceBatch(benchmark::State& state) {
+    const auto n = static_cast<std::size_t>(state.range(0));
+    StudyPlanner planner = makePlanner(n);
+    ScoreStream stream(n);
+    std::vector<ScoreUpdate> updates;
+    for (std::size_t i = 0; i < stream.names.size(); ++i) updates.push_back({stream.names[i], stream.scores[i]});
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(planner.recordPerformanceBatch(std::span(updates).subspan(i, 1024)));
+        i = (i + 1024) & (updates.size() - 1);
+    }
+    state.SetItemsProcessed(state.iterations() * 1024);
+}
+
+// Removes up to 1024 spread-out subjects and adds them back, both as one batch.
+void BM_RemoveAddSubjects(benchmark::State& state) {
+    const auto n = static_cast<std::size_t>(state.range(0));
+    StudyPlanner planner = makePlanner(n);
+    std::vector<std::string> names;
+    std::vector<SubjectSpec> specs;
+    for (std::size_t i = 0; i < std::min<std::size_t>(n, 1024); ++i) names.push_back("S" + std::to_string(i * n / std::min<std::size_t>(n, 1024)));
+    std::vector<std::string_view> views(names.begin(), names.end());
+    for (const auto& name : names) specs.push_back({name, 5, 5, 75.0});
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(planner.removeSubjects(views));
+        benchmark::DoNotOptimize(planner.addSubjects(specs));
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(2 * names.size()));
+}
+
+void BM_UpdatePerformance(benchmark::State& state) {
+    Subject subject("Maths", 7, 8, 75.0);
+    ScoreStream stream(1);
+    std::size_t i = 0;
+    for (auto _ : state) {
+        subject.updatePerformance(stream.scores[i]);
+        benchmark::DoNotOptimize(subject.perfScore());
+        i = (i + 1) & (stream.scores.size() - 1);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_FindSubject(benchmark::State& state) {
+    const auto n = static_cast<std::size_t>(state.range(0));
+    StudyPlanner planner = makePlanner(n);
+    ScoreStream stream(n);
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(planner.findSubject(stream.names[i]));
+        i = (i + 1) & (stream.names.size() - 1);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_FindSubjectMissing(benchmark::State& state) {
+    const auto n = static_cast<std::size_t>(state.range(0));
+    StudyPlanner planner = makePlanner(n);
+    std::vector<std::string> missing;
+    for (std::size_t i = 0; i < 1024; ++i) missing.push_back("X" + std::to_string(i));
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(planner.findSubject(missing[i]));
+        i = (i + 1) & 1023;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Two planners over the same subject names, as when combining a student's two
+// weekly plans.
+void BM_ScheduleAdd(benchmark::State& state) {
+    const auto n = static_cast<std::size_t>(state.range(0));
+    Schedule a = makePlanner(n, 1).generateSchedule();
+    Schedule b = makePlanner(n, 2).generateSchedule();
+    for (auto _ : state) benchmark::DoNotOptimize(a + b);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_FlatScheduleAdd(benchmark::State& state) {
+    const auto n = static_cast<std::size_t>(state.range(0));
+    StudyPlanner pa = makePlanner(n, 1);
+    StudyPlanner pb = pa;
+    pb.setTotalDailyHours(6.0);
+    FlatSchedule a = pa.generateFlatSchedule();
+    FlatSchedule b = pb.generateFlatSchedule();
+    for (auto _ : state) benchmark::DoNotOptimize(a + b);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_SaveToFile(benchmark::State& state) {
+    const auto n = static_cast<std::size_t>(state.range(0));
+    StudyPlanner planner = makePlanner(n);
+    planner.replan();
+    const std::string path = benchFile("save");
+    for (auto _ : state) planner.saveToFile(path);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(std::filesystem::file_size(path)));
+    std::filesystem::remove(path);
+}
+
+void BM_LoadFromFile(benchmark::State& state) {
+    const auto n = static_cast<std::size_t>(state.range(0));
+    const std::string path = benchFile("load");
+    {
+        StudyPlanner planner = makePlanner(n);
+        planner.replan();
+        planner.saveToFile(path);
+    }
+    StudyPlanner planner;
+    for (auto _ : state) planner.loadFromFile(path);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(std::filesystem::file_size(path)));
+    std::filesystem::remove(path);
+}
+
+// A sharded store directory of `planners` students with 8 subjects each.
+std::string makeStoreDirectory(std::size_t planners) {
+    const auto dir = std::filesystem::temp_directory_path() / ("ssp-bench-store-" + std::to_string(planners));
+    std::filesystem::remove_all(dir);
+    ShardedPlannerStore store(4, dir.string());
+    for (std::size_t i = 0; i < planners; ++i) {
+        StudyPlanner planner = makePlanner(8, static_cast<unsigned>(i));
+        planner.replan();
+        store.addStudent("student" + std::to_string(i), std::move(planner)).get();
+    }
+    store.save();
+    return dir.string();
+}
+
+// Startup cost of the lazy store: should not grow with the planner count.
+void BM_LazyStoreOpen(benchmark::State& state) {
+    const std::string dir = makeStoreDirectory(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        LazyPlannerStore store(dir);
+        benchmark::DoNotOptimize(store.studentCount());
+    }
+    std::filesystem::remove_all(dir);
+}
+
+// Open plus the first planner: indexes one shard and hydrates one snapshot.
+void BM_LazyStoreFirstPlanner(benchmark::State& state) {
+    const std::string dir = makeStoreDirectory(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        LazyPlannerStore store(dir);
+        benchmark::DoNotOptimize(store.planner("student0"));
+    }
+    std::filesystem::remove_all(dir);
+}
+
+} // namespace
+
+BENCHMARK(BM_Replan)->Apply(subjectSizes)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_GenerateSchedule)->Apply(subjectSizes)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_CachedSchedule)->Apply(subjectSizes);
+BENCHMARK(BM_GenerateFlatSchedule)->Apply(subjectSizes)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_AdaptiveAdjust)->Apply(subjectSizes)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_RecordPerformance)->Apply(subjectSizes);
+BENCHMARK(BM_RecordAndReplan)->Apply(subjectSizes);
+BENCHMARK(BM_RecordPerformanceBatch)->Apply(subjectSizes);
+BENCHMARK(BM_RemoveAddSubjects)->Apply(subjectSizes)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_UpdatePerformance);
+BENCHMARK(BM_FindSubject)->Apply(subjectSizes);
+BENCHMARK(BM_FindSubjectMissing)->Apply(subjectSizes);
+BENCHMARK(BM_ScheduleAdd)->Apply(subjectSizes)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_FlatScheduleAdd)->Apply(subjectSizes)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_SaveToFile)->Apply(subjectSizes)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LoadFromFile)->Apply(subjectSizes)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LazyStoreOpen)->Arg(1000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_LazyStoreFirstPlanner)->Arg(1000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,397 @@
+// Regression tests for StudyPlanner. Build and run from the repo root:
+//
+//     g++ -std=c++20 -O2 -pthread -o planner_tests tests/planner_tests.cpp && ./planner_tests
+//
+// Each test is a function that throws on failure; main runs them all and
+// exits non-zero if any failed.
+#define SSP_NO_MAIN
+#include "../SmartStudyPlanner.cpp"
+
+namespace {
+
+void check(bool ok, const std::string& what) {
+    if (!ok) throw std::runtime_error(what);
+}
+
+std::string hoursOf(const Schedule& schedule) {
+    std::ostringstream out;
+    for (const auto& [name, hours] : schedule.alloc) out << name << '=' << hours << ';';
+    return out.str();
+}
+
+// Weights by importance only, so its plan differs from the default one.
+struct ImportanceOnly {
+    static double weight(int, int importance, double) { return importance; }
+};
+
+StudyPlanner samplePlanner() {
+    StudyPlanner planner;
+    planner.addSubject("Math", 9, 10, 80.0);
+    planner.addSubject("History", 4, 5, 90.0);
+    planner.setTotalDailyHours(4.0);
+    return planner;
+}
+
+// A policy replan rewrites the hours, so the next default generateSchedule
+// must not reuse the memoized plan without putting its hours back.
+void testPolicyReplanThenDefaultSchedule() {
+    StudyPlanner planner = samplePlanner();
+    const std::string defaultPlan = hoursOf(planner.generateSchedule());
+    const std::uint64_t before = planner.version();
+    const std::string policyPlan = hoursOf(planner.generateSchedule<ImportanceOnly>());
+    check(policyPlan != defaultPlan, "policy plan should differ from the default plan");
+    check(planner.version() != before, "policy replan must bump version()");
+    check(hoursOf(planner.showCurrentSchedule()) == policyPlan, "subjects should hold the policy plan");
+    check(hoursOf(planner.generateSchedule()) == defaultPlan, "generateSchedule returned a stale plan");
+    check(hoursOf(planner.showCurrentSchedule()) == defaultPlan, "generateSchedule did not rewrite the subjects");
+}
+
+// A plan generated on a hydrated planner marks it dirty, so eviction under a
+// zero budget keeps it resident instead of dropping the new hours.
+void testLazyStoreKeepsGeneratedPlan() {
+    const std::string dir = (std::filesystem::temp_directory_path() / "ssp-test-lazy-store").string();
+    std::filesystem::remove_all(dir);
+    {
+        ShardedPlannerStore store(2, dir);
+        for (const char* id : {"alice", "bob", "carol"}) store.addStudent(id, samplePlanner()).get();
+        store.save();
+    }
+    std::string plan;
+    {
+        LazyPlannerStore store(dir, 0);
+        plan = hoursOf(store.planner("alice")->generateSchedule());
+        check(plan != hoursOf(samplePlanner().showCurrentSchedule()), "generate should change the saved hours");
+        store.planner("bob");
+        store.planner("carol");
+        check(hoursOf(store.planner("alice")->showCurrentSchedule()) == plan, "evicted planner lost its plan");
+        store.save();
+    }
+    LazyPlannerStore reopened(dir, 0);
+    check(hoursOf(reopened.planner("alice")->showCurrentSchedule()) == plan, "saved store lost the plan");
+    std::filesystem::remove_all(dir);
+}
+
+// A saved planner can be evicted again even after a caller looked into its
+// subjects, as long as nobody still holds them.
+void testLazyStoreEvictsSavedPlanner() {
+    const std::string dir = (std::filesystem::temp_directory_path() / "ssp-test-lazy-evict").string();
+    std::filesystem::remove_all(dir);
+    {
+        ShardedPlannerStore store(1, dir);
+        store.addStudent("alice", samplePlanner()).get();
+        store.save();
+    }
+    LazyPlannerStore store(dir);
+    store.planner("alice")->findSubject("Math")->updatePerformance(20.0);
+    store.save();
+    store.setMemoryBudget(0);
+    check(store.stats().resident == 0, "a saved, unshared planner was not evicted");
+    check(store.planner("alice")->findSubject("Math")->perfScore() < 80.0, "the change made through findSubject was lost");
+    std::filesystem::remove_all(dir);
+}
+
+// NaN slips past range checks, so every entry point must refuse non-finite
+// scores and hours and leave the planner as it was.
+void testNonFiniteInputsAreRejected() {
+    StudyPlanner planner = samplePlanner();
+    const std::string plan = hoursOf(planner.generateSchedule());
+    const double nan = std::numeric_limits<double>::quiet_NaN(), inf = std::numeric_limits<double>::infinity();
+    auto throws = [](auto&& fn) {
+        try {
+            fn();
+        } catch (const std::runtime_error&) {
+            return true;
+        }
+        return false;
+    };
+    const double scores[] = {70.0, nan};
+    check(throws([&] { planner.recordPerformance("Math", nan); }), "recordPerformance took NaN");
+    check(throws([&] { planner.recordAndReplan("Math", inf); }), "recordAndReplan took infinity");
+    check(throws([&] { planner.recordPerformances("Math", scores, true); }), "recordPerformances took NaN");
+    check(throws([&] { planner.setTotalDailyHours(inf); }), "setTotalDailyHours took infinity");
+    check(throws([&] { planner.setTotalDailyHours(nan); }), "setTotalDailyHours took NaN");
+    check(throws([&] { planner.addSubject("Art", 3, 3, nan); }), "addSubject took NaN");
+    const SubjectSpec spec{"Art", 3, 3, nan};
+    check(!planner.addSubjects(std::span(&spec, 1)).ok(), "addSubjects took NaN");
+    check(planner.subjectCount() == 2 && hoursOf(planner.generateSchedule()) == plan, "a rejected input changed the plan");
+}
+
+// from_chars reads "nan" and "inf", so the importer must refuse them itself.
+void testCsvImportRejectsNonFiniteRows() {
+    const std::string path = (std::filesystem::temp_directory_path() / "ssp-test-nonfinite.csv").string();
+    {
+        std::ofstream out(path);
+        out << "name,difficulty,importance,perfScore,allocatedHours\n"
+            << "Math,5,5,nan,0\n" << "Art,3,3,50,inf\n" << "History,4,5,90,1.5\n";
+    }
+    StudyPlanner planner;
+    const CsvImportReport report = planner.importCSV(path);
+    check(report.rows == 3 && report.imported == 1 && report.errors.size() == 2, "non-finite rows were imported");
+    check(planner.subjectCount() == 1 && planner.subject("History"), "the valid row was not imported");
+    std::filesystem::remove(path);
+}
+
+// The server's checkpoints skip the save unless modified() says it would write
+// something: a change, a new student or a removal.
+void testLazyStoreModifiedTracksChanges() {
+    const std::string dir = (std::filesystem::temp_directory_path() / "ssp-test-lazy-modified").string();
+    std::filesystem::remove_all(dir);
+    {
+        LazyPlannerStore store(dir);
+        check(!store.modified(), "an empty store is modified");
+        store.addStudent("alice", samplePlanner());
+        store.addStudent("bob", samplePlanner());
+        check(store.modified(), "new students were not seen");
+        store.save();
+        check(!store.modified(), "a saved store is still modified");
+    }
+    LazyPlannerStore store(dir);
+    check(store.planner("alice")->subjectCount() == 2 && !store.modified(), "hydrating a planner counted as a change");
+    store.planner("alice")->setTotalDailyHours(6.0);
+    check(store.modified(), "a changed planner was not seen");
+    store.save();
+    store.removeStudent("bob");
+    check(store.modified(), "a removal was not seen");
+    store.save();
+    check(!store.modified(), "a saved removal is still modified");
+    std::filesystem::remove_all(dir);
+}
+
+// A reopened DurablePlanner replays its log up to a torn tail, cuts the tail
+// off, and folds in the rotated log of a compaction that did not finish.
+void testJournalReplayAfterTornTailAndInterruptedCompaction() {
+    const auto base = (std::filesystem::temp_directory_path() / "ssp-test-journal").string();
+    auto clean = [&] {
+        for (const char* ext : {".snap", ".wal", ".wal.old", ".snap.tmp"}) std::filesystem::remove(base + ext);
+    };
+    clean();
+    std::uintmax_t intact = 0;
+    {
+        DurablePlanner durable(base);
+        durable.addSubject("Math", 9, 10, 80.0);
+        durable.addSubject("History", 4, 5, 90.0);
+        durable.recordPerformance("Math", 40.0);
+        durable.sync();
+        intact = std::filesystem::file_size(base + ".wal");
+    }
+    {
+        std::ofstream wal(base + ".wal", std::ios::binary | std::ios::app);
+        wal << "torn record";
+    }
+    {
+        DurablePlanner durable(base);
+        check(std::filesystem::file_size(base + ".wal") == intact, "the torn tail was not cut off");
+        check(durable.lastLsn() == 3 && durable.planner().subjectCount() == 2, "replay lost records");
+        check(durable.planner().subject("Math")->perfScore() < 80.0, "the score was not replayed");
+        durable.setTotalDailyHours(6.0);
+    }
+    // A compaction that died after rotating the log, before its snapshot landed.
+    std::filesystem::rename(base + ".wal", base + ".wal.old");
+    {
+        DurablePlanner durable(base);
+        check(!std::filesystem::exists(base + ".wal.old"), "the rotated log was left behind");
+        check(durable.planner().subjectCount() == 2 && durable.planner().getTotalDailyHours() == 6.0,
+              "the rotated log was not replayed");
+        check(durable.lastLsn() == 4, "LSNs restarted after the interrupted compaction");
+    }
+    {
+        DurablePlanner durable(base);
+        check(durable.planner().subjectCount() == 2 && durable.planner().getTotalDailyHours() == 6.0,
+              "the folded snapshot lost state");
+        const std::string huge(std::size_t(1) << 20, 'x');
+        bool threw = false;
+        try {
+            durable.addSubject(huge, 1, 1);
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        check(threw && durable.lastLsn() == 4 && durable.planner().subjectCount() == 2,
+              "an oversized record was logged");
+    }
+    clean();
+}
+
+// Once stopped, nothing drains the ingestor's queue: pushes must fail instead
+// of spinning and flush() must return instead of waiting for them.
+void testIngestorRefusesScoresAfterStop() {
+    StudyPlanner planner = samplePlanner();
+    IngestOptions options;
+    options.capacity = 2;
+    ScoreIngestor ingestor(planner, options);
+    std::thread producer([&] {
+        try {
+            while (true) ingestor.push("Math", 50.0);
+        } catch (const std::runtime_error&) {
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    ingestor.stop();
+    producer.join();
+    check(!ingestor.tryPush("Math", 50.0), "tryPush queued a score after stop");
+    ingestor.flush();
+}
+
+// Back-to-back async saves to one path must leave the newest one on disk,
+// and every caller's future must complete.
+void testAsyncSavesLandInOrder() {
+    const std::string path = (std::filesystem::temp_directory_path() / "ssp-test-async.csv").string();
+    StudyPlanner planner = samplePlanner();
+    std::vector<std::future<void>> saves;
+    {
+        AsyncFileWriter writer;
+        for (int i = 1; i <= 50; ++i) {
+            planner.setTotalDailyHours(i);
+            planner.replan();
+            saves.push_back(planner.saveToFileAsync(path, writer));
+        }
+    }
+    for (auto& save : saves) save.get();
+    StudyPlanner loaded;
+    loaded.loadFromFile(path);
+    check(hoursOf(loaded.showCurrentSchedule()) == hoursOf(planner.showCurrentSchedule()), "an older save won");
+    std::filesystem::remove(path);
+}
+
+// A moved-from planner is empty but usable, for construction and assignment.
+void testMovedFromPlannerIsUsable() {
+    StudyPlanner p = samplePlanner();
+    StudyPlanner q = std::move(p);
+    p.addSubject("Art", 3, 3, 60.0);
+    check(p.subjectCount() == 1 && q.subjectCount() == 2, "move construction left a broken planner");
+    StudyPlanner r;
+    r = std::move(q);
+    q.addSubject("Art", 3, 3, 60.0);
+    check(q.subjectCount() == 1 && r.subjectCount() == 2, "move assignment left a broken planner");
+    check(hoursOf(r.generateSchedule()) == hoursOf(samplePlanner().generateSchedule()), "moved planner changed");
+}
+
+// whatIf() reuses its sorted base while the planner is unchanged, and must
+// rebuild it after a mutator or a change made through findSubject.
+void testWhatIfBaseFollowsPlanner() {
+    StudyPlanner planner = samplePlanner();
+    const double math = planner.whatIf().hoursFor("Math");
+    check(planner.whatIf().withScore("Math", 20.0).hoursFor("Math") > math, "preview ignored the change");
+    check(planner.whatIf().hoursFor("Math") == math, "previews should not change the base");
+    planner.recordPerformance("Math", 20.0);
+    const double lowered = planner.whatIf().hoursFor("Math");
+    check(lowered > math, "whatIf reused a base from before recordPerformance");
+    planner.findSubject("Math")->updatePerformance(100.0);
+    check(planner.whatIf().hoursFor("Math") < lowered, "whatIf reused a base from before a findSubject change");
+}
+
+// Growing a container moves planners, so none of them ends up sharing
+// subjects, including those a shard store reloads from disk.
+void testMovesDoNotAlias() {
+    std::vector<StudyPlanner> planners;
+    for (int i = 0; i < 3; ++i) {
+        StudyPlanner p = samplePlanner();
+        planners.push_back(std::move(p));
+    }
+    for (const auto& p : planners) check(!p.aliased(), "a moved planner reports aliased()");
+    const std::string dir = (std::filesystem::temp_directory_path() / "ssp_test_moves").string();
+    std::filesystem::remove_all(dir);
+    {
+        ShardedPlannerStore store(2, dir);
+        for (int i = 0; i < 20; ++i) store.addStudent("s" + std::to_string(i), samplePlanner()).get();
+        store.save();
+    }
+    ShardedPlannerStore reloaded(2, dir);
+    for (int i = 0; i < 20; ++i) {
+        const bool aliased = reloaded.withStudent("s" + std::to_string(i), [](StudyPlanner& p) { return p.aliased(); }).get();
+        check(!aliased, "a reloaded planner reports aliased()");
+    }
+    std::filesystem::remove_all(dir);
+}
+
+// Saves and loads from several threads must not share a generation, or they
+// write the same temporary files and delete each other's output.
+void testConcurrentShardedSavesDoNotCollide() {
+    const std::string dir = (std::filesystem::temp_directory_path() / "ssp_test_concurrent_saves").string();
+    std::filesystem::remove_all(dir);
+    {
+        ShardedPlannerStore store(2, dir);
+        for (int i = 0; i < 20; ++i) store.addStudent("s" + std::to_string(i), samplePlanner()).get();
+        std::vector<std::thread> savers;
+        for (int t = 0; t < 4; ++t)
+            savers.emplace_back([&store, t] {
+                for (int k = 0; k < 5; ++k) {
+                    if (t == 0 && k % 2) store.load();
+                    else store.save();
+                }
+            });
+        for (auto& th : savers) th.join();
+    }
+    std::size_t files = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) files += entry.is_regular_file();
+    check(files == 2, "concurrent saves left " + std::to_string(files) + " files instead of one generation");
+    ShardedPlannerStore reloaded(2, dir);
+    check(reloaded.studentCount() == 20, "concurrent saves lost students");
+    std::filesystem::remove_all(dir);
+}
+
+// A findSubject handle makes the planner aliased only while it is held, and
+// releasing it moves the version so memos see what was changed through it.
+void testReleasedSubjectHandleEndsAliasing() {
+    StudyPlanner planner = samplePlanner();
+    planner.generateSchedule();
+    const std::uint64_t before = planner.version();
+    planner.findSubject("Math");
+    check(!planner.aliased(), "a discarded findSubject result keeps the planner aliased");
+    check(planner.version() != before, "releasing a subject handle must move version()");
+    auto math = planner.findSubject("Math");
+    check(planner.aliased(), "a held findSubject result must alias the planner");
+    math.reset();
+    check(!planner.aliased(), "the planner stays aliased after the handle is released");
+}
+
+// Copies share subjects allocated from the original's arena; releasing them
+// on other threads while the owner keeps allocating must be safe (run under
+// -fsanitize=thread to check).
+void testSharedSubjectsReleasedOnOtherThreads() {
+    StudyPlanner owner;
+    for (int i = 0; i < 200; ++i) owner.addSubject("S" + std::to_string(i), 1 + i % 10, 1 + i % 7);
+    std::vector<StudyPlanner> copies(3, owner);
+    for (int i = 0; i < 200; ++i) owner.removeSubject("S" + std::to_string(i));
+    std::vector<std::thread> threads;
+    for (auto& copy : copies) {
+        threads.emplace_back([&copy] {
+            for (int i = 0; i < 200; ++i) copy.removeSubject("S" + std::to_string(i));
+        });
+    }
+    for (int i = 0; i < 200; ++i) owner.addSubject("T" + std::to_string(i), 5, 5);
+    for (auto& t : threads) t.join();
+    check(owner.subjectCount() == 200, "owner lost subjects");
+}
+
+} // namespace
+
+int main() {
+    const std::pair<const char*, void (*)()> tests[] = {
+        {"policy replan then default schedule", testPolicyReplanThenDefaultSchedule},
+        {"lazy store keeps a generated plan", testLazyStoreKeepsGeneratedPlan},
+        {"lazy store evicts a saved planner", testLazyStoreEvictsSavedPlanner},
+        {"lazy store tracks modifications", testLazyStoreModifiedTracksChanges},
+        {"non-finite inputs are rejected", testNonFiniteInputsAreRejected},
+        {"CSV import rejects non-finite rows", testCsvImportRejectsNonFiniteRows},
+        {"journal replay after torn tail and interrupted compaction", testJournalReplayAfterTornTailAndInterruptedCompaction},
+        {"ingestor refuses scores after stop", testIngestorRefusesScoresAfterStop},
+        {"async saves land in order", testAsyncSavesLandInOrder},
+        {"moved-from planner is usable", testMovedFromPlannerIsUsable},
+        {"whatIf base follows the planner", testWhatIfBaseFollowsPlanner},
+        {"moves do not alias", testMovesDoNotAlias},
+        {"concurrent sharded saves do not collide", testConcurrentShardedSavesDoNotCollide},
+        {"released subject handle ends aliasing", testReleasedSubjectHandleEndsAliasing},
+        {"shared subjects released on other threads", testSharedSubjectsReleasedOnOtherThreads},
+    };
+    int failed = 0;
+    for (const auto& [name, test] : tests) {
+        try {
+            test();
+            std::cout << "ok   " << name << "\n";
+        } catch (const std::exception& ex) {
+            ++failed;
+            std::cout << "FAIL " << name << ": " << ex.what() << "\n";
+        }
+    }
+    return failed ? 1 : 0;
+}